@@ -43,6 +43,23 @@ int artio_fileset_set_buffer_size( int buffer_size ) {
 	return ARTIO_SUCCESS;
 }
 
+int artio_fh_async_buffers = 0;
+
+/*
+ * Write through a ring of num_buffers buffers drained by a background
+ * thread, so writers continue while earlier data reaches the disk.  Only
+ * supported by the POSIX file layer; 0 or 1 restores synchronous writes.
+ * Affects files opened for writing after the call.
+ */
+int artio_fileset_set_async_buffers( int num_buffers ) {
+	if ( num_buffers < 0 ) {
+		return ARTIO_ERR_INVALID_BUFFER_SIZE;
+	}
+
+	artio_fh_async_buffers = num_buffers;
+	return ARTIO_SUCCESS;
+}
+
 artio_fileset *artio_fileset_open(char * file_prefix, int type, const artio_context *context) {
 	artio_fh *head_fh;
 	char filename[512];
@@ -88,12 +105,16 @@ artio_fileset *artio_fileset_open(char * file_prefix, int type, const artio_cont
 		artio_parameter_get_int(handle, "ARTIO_MINOR_VERSION", &artio_minor );
 	}
 
-	if ( artio_major > ARTIO_MAJOR_VERSION ) {
-		fprintf(stderr,"ERROR: artio file version newer than library (%u.%u vs %u.%u).\n",
-			artio_major, artio_minor, ARTIO_MAJOR_VERSION, ARTIO_MINOR_VERSION );
+	if ( artio_major > ARTIO_COMPRESSED_MAJOR_VERSION ) {
+		fprintf(stderr,"ERROR: artio file version newer than library (%u.%u vs %u.%u, "
+			"which reads up to major version %u).\n",
+			artio_major, artio_minor, ARTIO_MAJOR_VERSION, ARTIO_MINOR_VERSION,
+			ARTIO_COMPRESSED_MAJOR_VERSION );
 		artio_fileset_destroy(handle);
 		return NULL;
 	}
+	handle->major_version = artio_major;
+	handle->minor_version = artio_minor;
 
 	artio_parameter_get_long(handle, "num_root_cells", &handle->num_root_cells);
 
@@ -189,6 +210,8 @@ artio_fileset *artio_fileset_create(char * file_prefix,
 
 	handle->num_local_root_cells = local_root_cells;
 	handle->num_root_cells = root_cells;
+	handle->proc_sfc_begin = 0;
+	handle->proc_sfc_end = root_cells-1;
 
 	handle->nBitsPerDim = 0;
 	tmp = handle->num_root_cells >> 3;
@@ -210,6 +233,8 @@ artio_fileset *artio_fileset_create(char * file_prefix,
 
 	artio_parameter_set_int(handle, "ARTIO_MAJOR_VERSION", ARTIO_MAJOR_VERSION );
 	artio_parameter_set_int(handle, "ARTIO_MINOR_VERSION", ARTIO_MINOR_VERSION );
+	handle->major_version = ARTIO_MAJOR_VERSION;
+	handle->minor_version = ARTIO_MINOR_VERSION;
 
 	return handle;
 }
@@ -287,6 +312,8 @@ artio_fileset *artio_fileset_allocate( char *file_prefix, int mode,
 		handle->rank = my_rank;
 		handle->num_procs = num_procs;
 		handle->endian_swap = 0;
+		handle->major_version = ARTIO_MAJOR_VERSION;
+		handle->minor_version = ARTIO_MINOR_VERSION;
 
 		handle->num_grid = -1;
 		handle->num_root_cells = -1;
@@ -351,6 +378,139 @@ int artio_find_file( int64_t *file_sfc_index, int num_files, int64_t sfc) {
 	return a;
 }
 
+/*
+ * Whether local root cell il is not followed, in its file, by the next
+ * root cell in sfc_list, so its declared size cannot be recovered from
+ * the offset table once sfc_size holds offsets.
+ */
+int artio_sfc_is_tail( int64_t *sfc_list, int64_t num_sfc, int64_t il,
+		int64_t *file_sfc_index, int num_files ) {
+	return ( il + 1 >= num_sfc ||
+			sfc_list[il+1] != sfc_list[il] + 1 ||
+			artio_find_file( file_sfc_index, num_files, sfc_list[il+1] ) !=
+				artio_find_file( file_sfc_index, num_files, sfc_list[il] ) );
+}
+
+int artio_sfc_tail_compare( const void *a, const void *b ) {
+	int64_t sfc_a = *(const int64_t *)a;
+	int64_t sfc_b = *(const int64_t *)b;
+
+	return ( sfc_a > sfc_b ) - ( sfc_a < sfc_b );
+}
+
+/*
+ * Size declared for local root cell il of a committed write handle, whose
+ * sfc_size holds offsets, from the next offset or the end offset kept by
+ * artio_fileset_distribute_sfc_to_files.
+ */
+int64_t artio_sfc_declared_size( int64_t *sfc_list, int64_t *sfc_size,
+		int64_t il, int64_t num_sfc_tails, int64_t *sfc_tail ) {
+	int64_t a, b, c;
+
+	a = 0;
+	b = num_sfc_tails;
+	while ( a < b ) {
+		c = ( a + b ) / 2;
+		if ( sfc_tail[2*c] < sfc_list[il] ) {
+			a = c + 1;
+		} else {
+			b = c;
+		}
+	}
+
+	if ( a < num_sfc_tails && sfc_tail[2*a] == sfc_list[il] ) {
+		return sfc_tail[2*a+1] - sfc_size[il];
+	}
+	return sfc_size[il+1] - sfc_size[il];
+}
+
+int artio_fileset_get_sfc_range( artio_fileset *handle,
+		int64_t *sfc_begin, int64_t *sfc_end ) {
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	*sfc_begin = handle->proc_sfc_begin;
+	*sfc_end = handle->proc_sfc_end;
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Split the local root cells sfc_list[0,num_sfc), which must be strictly
+ * increasing (ARTIO_ERR_INVALID_SFC otherwise), into num_writers
+ * contiguous runs which never share a file.  Whole files are assigned to
+ * the writer owning the midpoint of their root cells, so writers receive
+ * roughly equal numbers of root cells; writers may be left empty when
+ * there are fewer files than writers.  writer_index[k] is the first entry
+ * of sfc_list belonging to writer k, writer_index[num_writers] = num_sfc.
+ */
+int artio_fileset_partition_writers( int64_t *sfc_list, int64_t num_sfc,
+		int64_t *file_sfc_index, int num_files,
+		int num_writers, int64_t *writer_index ) {
+	int file, writer, k;
+	int64_t i, j;
+
+	/* a list returning to an earlier file would hand it to two writers */
+	for ( i = 1; i < num_sfc; i++ ) {
+		if ( sfc_list[i] <= sfc_list[i-1] ) {
+			return ARTIO_ERR_INVALID_SFC;
+		}
+	}
+
+	k = 0;
+	writer_index[0] = 0;
+
+	i = 0;
+	while ( i < num_sfc ) {
+		file = artio_find_file( file_sfc_index, num_files, sfc_list[i] );
+		if ( file == -1 ) {
+			return ARTIO_ERR_INVALID_SFC;
+		}
+
+		j = i+1;
+		while ( j < num_sfc && sfc_list[j] < file_sfc_index[file+1] ) {
+			j++;
+		}
+
+		writer = MIN( num_writers-1, (i+j)*num_writers / (2*num_sfc) );
+		while ( k < writer ) {
+			writer_index[++k] = i;
+		}
+		i = j;
+	}
+
+	while ( k < num_writers ) {
+		writer_index[++k] = num_sfc;
+	}
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Allocate a fileset sharing the header, parameters and context of an
+ * open write handle, used to hold one component of a forked writer.
+ * The caller fills in the component; release with artio_fileset_free_view.
+ */
+artio_fileset *artio_fileset_writer_view( artio_fileset *handle ) {
+	artio_fileset *view = (artio_fileset *)malloc(sizeof(artio_fileset));
+	if ( view != NULL ) {
+		memcpy( view, handle, sizeof(artio_fileset) );
+		view->open_type = ARTIO_OPEN_HEADER;
+		view->proc_sfc_index = NULL;
+		view->grid = NULL;
+		view->particle = NULL;
+		view->num_local_root_cells = 0;
+		view->proc_sfc_begin = 0;
+		view->proc_sfc_end = -1;
+	}
+	return view;
+}
+
+void artio_fileset_free_view( artio_fileset *view ) {
+	/* parameters and context belong to the parent handle */
+	free( view );
+}
+
 int artio_fileset_distribute_sfc_to_files(
 		artio_fileset *handle,
 		int64_t *sfc_list,
@@ -359,7 +519,9 @@ int artio_fileset_distribute_sfc_to_files(
 		int allocation_strategy,
 		const char file_suffix,
 		int64_t *file_sfc_index,
-		artio_fh **ffh ) {
+		artio_fh **ffh,
+		int64_t *num_sfc_tails,
+		int64_t **sfc_tail ) {
 
 	int proc, file, count;
 	int mode, ret;
@@ -367,12 +529,14 @@ int artio_fileset_distribute_sfc_to_files(
 	char filename[1024];
 	int64_t il, disp;
 	int64_t offset, sfc_count;
+	int64_t total_size;
 	int64_t num_sfc_per_proc;
 	int64_t sfc_offset_range_start;
 	int64_t sfc_offset_range_end;
 	int64_t sfc_offset_size;
 	int64_t first_file_sfc;
 	int64_t last_file_sfc;
+	int64_t size;
 	int64_t *sfc_offset_table;
 	int64_t *sfc_list_recv;
 	int64_t *sfc_size_recv;
@@ -547,6 +711,13 @@ int artio_fileset_distribute_sfc_to_files(
 		MPI_Send( &offset, 1, MPI_INT64_T, handle->rank+1,
 				handle->rank, handle->context->comm );
 	}
+
+	/* the last rank holds the total size of all root trees */
+	total_size = offset;
+	MPI_Bcast( &total_size, 1, MPI_INT64_T, handle->num_procs-1,
+			handle->context->comm );
+#else
+	total_size = offset;
 #endif /* ARTIO_MPI */
 
 	/* use allocation strategy to divide sfc range into files */
@@ -562,7 +733,46 @@ int artio_fileset_distribute_sfc_to_files(
 			}
 			file_sfc_index[num_files] = handle->num_root_cells;
 			break;
-		case ARTIO_ALLOC_EQUAL_SIZE: /* not implemented yet */
+		case ARTIO_ALLOC_EQUAL_SIZE:
+			if ( num_files > handle->num_root_cells ) {
+				return ARTIO_ERR_INVALID_FILE_NUMBER;
+			}
+
+			/* each root tree is weighted by its size plus its entry in the
+			 * file offset table.  Boundary file begins at the first sfc whose
+			 * cumulative weight reaches file/num_files of the total; ranks
+			 * only see their own range, so take the minimum across ranks */
+			total_size += handle->num_root_cells*sizeof(int64_t);
+			for ( file = 1; file < num_files; file++ ) {
+				file_sfc_index[file] = handle->num_root_cells;
+			}
+
+			file = 1;
+			for ( il = 0; il < sfc_offset_size && file < num_files; il++ ) {
+				while ( file < num_files &&
+						sfc_offset_table[il] + (sfc_offset_range_start+il)*(int64_t)sizeof(int64_t) >=
+						(int64_t)((double)total_size*file/num_files) ) {
+					file_sfc_index[file] = sfc_offset_range_start+il;
+					file++;
+				}
+			}
+
+#ifdef ARTIO_MPI
+			if ( num_files > 1 ) {
+				MPI_Allreduce( MPI_IN_PLACE, &file_sfc_index[1], num_files-1,
+						MPI_INT64_T, MPI_MIN, handle->context->comm );
+			}
+#endif /* ARTIO_MPI */
+
+			/* every file must hold at least one root cell */
+			file_sfc_index[0] = 0;
+			for ( file = 1; file < num_files; file++ ) {
+				file_sfc_index[file] = MAX( file_sfc_index[file], file_sfc_index[file-1]+1 );
+				file_sfc_index[file] = MIN( file_sfc_index[file],
+						handle->num_root_cells - (num_files - file) );
+			}
+			file_sfc_index[num_files] = handle->num_root_cells;
+			break;
 		case ARTIO_ALLOC_EQUAL_PROC: /* deprecated */
 		default:
 			return ARTIO_ERR_INVALID_ALLOC_STRATEGY;
@@ -598,6 +808,21 @@ int artio_fileset_distribute_sfc_to_files(
 	}
 #endif /* ARTIO_MPI */
 
+	/* root cells whose size does not follow from the offset of the next
+	 * local root cell keep their end offset */
+	*num_sfc_tails = 0;
+	for ( il = 0; il < handle->num_local_root_cells; il++ ) {
+		if ( artio_sfc_is_tail( sfc_list, handle->num_local_root_cells, il,
+				file_sfc_index, num_files ) ) {
+			(*num_sfc_tails)++;
+		}
+	}
+	*sfc_tail = (int64_t *)malloc( 2*MAX(*num_sfc_tails,1)*sizeof(int64_t) );
+	if ( *sfc_tail == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+	*num_sfc_tails = 0;
+
 	/* put local offset table into sfc_size */
 #ifdef ARTIO_MPI
 	/* set up recives */
@@ -643,8 +868,15 @@ int artio_fileset_distribute_sfc_to_files(
 	/* copy sfc into per-proc arrays */
 	for ( il = 0; il < handle->num_local_root_cells; il++ ) {
 		proc = sfc_list[il] / num_sfc_per_proc;
+		size = sfc_size[il];
 		sfc_size[il] = sfc_size_send[ proc_sfc_offset[proc] ];
 		proc_sfc_offset[proc]++;
+		if ( artio_sfc_is_tail( sfc_list, handle->num_local_root_cells, il,
+				file_sfc_index, num_files ) ) {
+			(*sfc_tail)[2*(*num_sfc_tails)] = sfc_list[il];
+			(*sfc_tail)[2*(*num_sfc_tails)+1] = sfc_size[il] + size;
+			(*num_sfc_tails)++;
+		}
 	}
 
 	free( sfc_list_recv );
@@ -656,10 +888,19 @@ int artio_fileset_distribute_sfc_to_files(
 	free( proc_sfc_offset );
 #else
 	for ( il = 0; il < handle->num_local_root_cells; il++ ) {
+		size = sfc_size[il];
 		sfc_size[il] = sfc_offset_table[ sfc_list[il] ];
+		if ( artio_sfc_is_tail( sfc_list, handle->num_local_root_cells, il,
+				file_sfc_index, num_files ) ) {
+			(*sfc_tail)[2*(*num_sfc_tails)] = sfc_list[il];
+			(*sfc_tail)[2*(*num_sfc_tails)+1] = sfc_size[il] + size;
+			(*num_sfc_tails)++;
+		}
 	}
 #endif /* ARTIO_MPI */
 
+	qsort( *sfc_tail, *num_sfc_tails, 2*sizeof(int64_t), artio_sfc_tail_compare );
+
 	/* determine which files we write to */
 	file_access = (int *)malloc(num_files * sizeof(int));
 	if ( file_access == NULL ) {
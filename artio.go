@@ -1,53 +1,22 @@
 package artio
 
 /*
-#cgo CFLAGS: -O2 -g
-#cgo LDFLAGS: -lm
+#cgo CFLAGS: -O3 -g -DARTIO_CGO
+#cgo LDFLAGS: -lm -lpthread
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
 #include <stdint.h>
-#include "artio.h"
-
-int64_t GetPositionsCallbackN;
-int64_t GetPositionsCallbackI;
-
-int CountCallback(
-	int64_t sfc_index, int species, int subspecies, int64_t pid,
-	double *primary_variables, float *secondary_variables, void *params
-) {
-	int64_t *counts = (int64_t *) params;
-	counts[species]++;
-	return 0;
-}
-
-int GetPositionsCallback(
-    int64_t sfx_idx, int species, int subspecies, int64_t pid,
-    double *primary_variables, float *secondary_variables, void *params
-) {
-    int64_t i, n;
-	Vector *buf;
-
-    buf = (Vector*) params;
-    i = GetPositionsCallbackI;
-	n = GetPositionsCallbackN;
-    if (i >= n) { return ARTIO_ERR_INVALID_SFC_RANGE; }
-
-    buf[i][0] = primary_variables[0];
-    buf[i][1] = primary_variables[1];
-    buf[i][2] = primary_variables[2];
-	
-    GetPositionsCallbackI++;
-	
-    return 0;
-}
+#include "artio_cgo.h"
 */
 import "C"
 
 import (
 	"bytes"
+	"encoding/binary"
 	"fmt"
+	"math"
 
 	"unsafe"
 )
@@ -124,6 +93,13 @@ const (
 	Long
 )
 
+type ReadOption int
+const (
+	ReadLeafs ReadOption = 1 + iota
+	ReadRefined
+	ReadAll
+)
+
 const (
 	MaxStringLength = 256
 )
@@ -166,6 +142,9 @@ type Key struct {
 	length int
 }
 
+// Iterate steps through the keys of the fileset. Its position is shared by
+// every caller using the handle, so concurrent or nested loops should use
+// Keys instead.
 func (handle Fileset) Iterate() (key Key, ok bool) {
 	buf := make([]byte, 64)
 	ptrName := (*C.char)(unsafe.Pointer(&buf[0]))
@@ -192,23 +171,55 @@ func (handle Fileset) HasKey(name string) bool {
 	return 1 == C.artio_parameter_has_key(handle.ptr, cStr)
 }
 
-func (handle Fileset) Key(name string) Key {
-	if !handle.HasKey(name) {
-		panic(fmt.Sprintf("Key %s not in ARTIO file.", name))
-	}
+// Keys returns every key of the fileset in the order they are stored. It
+// keeps no state in the handle and may be called from several goroutines.
+func (handle Fileset) Keys() ([]Key, error) {
+	buf := make([]byte, 64)
+	ptrName := (*C.char)(unsafe.Pointer(&buf[0]))
+	var cursor unsafe.Pointer
+	keys := []Key{ }
 
-	length := 0
-	pType := 0
-	lengthPtr := (*C.int)(unsafe.Pointer(&length))
-	typePtr := (*C.int)(unsafe.Pointer(&pType))
+	for {
+		pType, length := C.int(0), C.int(0)
+		err := ErrorCode(C.artio_parameter_iterate_r(
+			handle.ptr, &cursor, ptrName, &pType, &length,
+		))
+		if err == ParameterExhausted {
+			return keys, nil
+		} else if err != Success {
+			return nil, fmt.Errorf(
+				"Could not read ARTIO parameters. ErrorCode = %d", err,
+			)
+		}
+		keys = append(keys, Key{ toString(buf), ParameterType(pType), int(length) })
+	}
+}
 
+// FindKey returns the named key, or an error if it is not in the fileset.
+func (handle Fileset) FindKey(name string) (Key, error) {
 	cStr := C.CString(name)
 	defer C.free(unsafe.Pointer(cStr))
 
-	C.artio_parameter_get_array_length(handle.ptr, cStr, lengthPtr)
-	C.artio_parameter_get_type(handle.ptr, cStr, typePtr)
+	pType, length := C.int(0), C.int(0)
+	err := ErrorCode(C.artio_parameter_get_type(handle.ptr, cStr, &pType))
+	if err == Success {
+		err = ErrorCode(
+			C.artio_parameter_get_array_length(handle.ptr, cStr, &length),
+		)
+	}
+	if err != Success {
+		return Key{ }, fmt.Errorf("Key %s not in ARTIO file.", name)
+	}
 
-	return Key{ name, ParameterType(pType), length }
+	return Key{ name, ParameterType(pType), int(length) }, nil
+}
+
+// Key returns the named key and panics if it is not in the fileset. See
+// FindKey and Header for lookups which return errors.
+func (handle Fileset) Key(name string) Key {
+	key, err := handle.FindKey(name)
+	if err != nil { panic(err.Error()) }
+	return key
 }
 
 func (handle Fileset) GetString(key Key) []string {
@@ -332,6 +343,175 @@ func (handle Fileset) GetLong(key Key) []int64 {
 	}
 }
 
+// Header is a snapshot of the parameters of a fileset, copied in a single
+// C call so that lookups are pure Go.
+type Header struct {
+	keys   []Key
+	values map[string]interface{}
+}
+
+var nativeEndian binary.ByteOrder = func() binary.ByteOrder {
+	x := uint16(1)
+	if *(*byte)(unsafe.Pointer(&x)) == 1 { return binary.LittleEndian }
+	return binary.BigEndian
+}()
+
+// Header copies every parameter of the fileset into a Header.
+func (handle Fileset) Header() (*Header, error) {
+	var cBuf *C.char
+	size := C.int64_t(0)
+	err := ErrorCode(C.artio_parameter_pack(handle.ptr, &cBuf, &size))
+	if err != Success {
+		return nil, fmt.Errorf(
+			"Could not read ARTIO parameters. ErrorCode = %d", err,
+		)
+	}
+	buf := C.GoBytes(unsafe.Pointer(cBuf), C.int(size))
+	C.free(unsafe.Pointer(cBuf))
+
+	hd := &Header{ values: map[string]interface{}{} }
+	for len(buf) > 0 {
+		end := bytes.IndexByte(buf, 0)
+		if end < 0 || len(buf) < end + 9 {
+			return nil, fmt.Errorf("Corrupted ARTIO parameter snapshot.")
+		}
+		name := string(buf[:end])
+		pType := ParameterType(int32(nativeEndian.Uint32(buf[end+1:])))
+		n := int(int32(nativeEndian.Uint32(buf[end+5:])))
+		buf = buf[end+9:]
+		if n < 0 || n > len(buf) {
+			return nil, fmt.Errorf("Corrupted ARTIO parameter snapshot.")
+		}
+		value := buf[:n]
+		buf = buf[n:]
+
+		key := Key{ name, pType, 0 }
+		switch pType {
+		case String:
+			strs := []string{}
+			for len(value) > 0 {
+				end := bytes.IndexByte(value, 0)
+				if end < 0 { end = len(value) - 1 }
+				strs = append(strs, string(value[:end]))
+				value = value[end+1:]
+			}
+			key.length = len(strs)
+			hd.values[name] = strs
+		case Char:
+			key.length = n
+			hd.values[name] = append([]byte{}, value...)
+		case Int:
+			out := make([]int32, n/4)
+			for i := range out { out[i] = int32(nativeEndian.Uint32(value[4*i:])) }
+			key.length = len(out)
+			hd.values[name] = out
+		case Float:
+			out := make([]float32, n/4)
+			for i := range out {
+				out[i] = math.Float32frombits(nativeEndian.Uint32(value[4*i:]))
+			}
+			key.length = len(out)
+			hd.values[name] = out
+		case Double:
+			out := make([]float64, n/8)
+			for i := range out {
+				out[i] = math.Float64frombits(nativeEndian.Uint64(value[8*i:]))
+			}
+			key.length = len(out)
+			hd.values[name] = out
+		case Long:
+			out := make([]int64, n/8)
+			for i := range out { out[i] = int64(nativeEndian.Uint64(value[8*i:])) }
+			key.length = len(out)
+			hd.values[name] = out
+		default:
+			return nil, fmt.Errorf("Unrecognized ARTIO type %d for '%s'.", pType, name)
+		}
+		hd.keys = append(hd.keys, key)
+	}
+
+	return hd, nil
+}
+
+// Keys returns the keys of the header in the order they are stored.
+func (hd *Header) Keys() []Key { return hd.keys }
+
+func (hd *Header) HasKey(name string) bool {
+	_, ok := hd.values[name]
+	return ok
+}
+
+func (hd *Header) lookup(name string, pType ParameterType) (interface{}, error) {
+	value, ok := hd.values[name]
+	if !ok {
+		return nil, fmt.Errorf("Key %s not in ARTIO file.", name)
+	}
+
+	var match bool
+	switch pType {
+	case String: _, match = value.([]string)
+	case Char:   _, match = value.([]byte)
+	case Int:    _, match = value.([]int32)
+	case Float:  _, match = value.([]float32)
+	case Double: _, match = value.([]float64)
+	case Long:   _, match = value.([]int64)
+	}
+	if !match {
+		return nil, fmt.Errorf("ARTIO key '%s' is not of type %d.", name, pType)
+	}
+	return value, nil
+}
+
+func (hd *Header) GetString(name string) ([]string, error) {
+	value, err := hd.lookup(name, String)
+	if err != nil { return nil, err }
+	return value.([]string), nil
+}
+
+func (hd *Header) GetChar(name string) ([]byte, error) {
+	value, err := hd.lookup(name, Char)
+	if err != nil { return nil, err }
+	return value.([]byte), nil
+}
+
+func (hd *Header) GetInt(name string) ([]int32, error) {
+	value, err := hd.lookup(name, Int)
+	if err != nil { return nil, err }
+	return value.([]int32), nil
+}
+
+func (hd *Header) GetFloat(name string) ([]float32, error) {
+	value, err := hd.lookup(name, Float)
+	if err != nil { return nil, err }
+	return value.([]float32), nil
+}
+
+func (hd *Header) GetDouble(name string) ([]float64, error) {
+	value, err := hd.lookup(name, Double)
+	if err != nil { return nil, err }
+	return value.([]float64), nil
+}
+
+func (hd *Header) GetLong(name string) ([]int64, error) {
+	value, err := hd.lookup(name, Long)
+	if err != nil { return nil, err }
+	return value.([]int64), nil
+}
+
+// GetIntOrLong returns an Int or Long key as int64s, for keys whose type
+// differs between versions of the format.
+func (hd *Header) GetIntOrLong(name string) ([]int64, error) {
+	switch value := hd.values[name].(type) {
+	case []int32:
+		out := make([]int64, len(value))
+		for i := range out { out[i] = int64(value[i]) }
+		return out, nil
+	case []int64:
+		return value, nil
+	}
+	return hd.GetLong(name)
+}
+
 func (handle Fileset) ParticleCacheSfcRange(start, end int64) error {
 	err := ErrorCode(C.artio_particle_cache_sfc_range(
 		handle.ptr, C.int64_t(start), C.int64_t(end),
@@ -459,14 +639,14 @@ func (handle Fileset) ReadParticle(
 	return id, subspecies, nil
 }
 
+// CountInRange returns the number of particles of each species in the sfc
+// range [sfcStart, sfcEnd]. Only the root cell headers are read.
 func (h Fileset) CountInRange(sfcStart, sfcEnd int64) ([]int64, error) {
-	// This needs to be done with C callbacks for performance reasons.
 	counts := make([]int64, h.GetInt(h.Key("num_particle_species"))[0])
-	ptrCounts := unsafe.Pointer(&counts[0])
+	ptrCounts := (*C.int64_t)(unsafe.Pointer(&counts[0]))
 
-	errCode := ErrorCode(C.artio_particle_read_sfc_range(
-		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd),
-		(C.artio_particle_callback)(C.CountCallback), ptrCounts,
+	errCode := ErrorCode(C.artio_particle_count_in_sfc_range(
+		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd), ptrCounts, nil,
 	))
 
 	if errCode != Success {
@@ -479,6 +659,34 @@ func (h Fileset) CountInRange(sfcStart, sfcEnd int64) ([]int64, error) {
 	return counts, nil
 }
 
+// CountPerSfc returns the number of particles of each species in every root
+// cell of the sfc range [sfcStart, sfcEnd]. The counts of root cell sfc are
+// at [(sfc - sfcStart)*numSpecies, (sfc - sfcStart + 1)*numSpecies).
+func (h Fileset) CountPerSfc(sfcStart, sfcEnd int64) ([]int32, error) {
+	numSpecies := int64(h.GetInt(h.Key("num_particle_species"))[0])
+	if sfcEnd < sfcStart {
+		return nil, fmt.Errorf("Invalid ARTIO sfc range (%d, %d).", sfcStart, sfcEnd)
+	}
+
+	counts := make([]int64, numSpecies)
+	perSfc := make([]int32, (sfcEnd - sfcStart + 1)*numSpecies)
+
+	errCode := ErrorCode(C.artio_particle_count_in_sfc_range(
+		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd),
+		(*C.int64_t)(unsafe.Pointer(&counts[0])),
+		(*C.int)(unsafe.Pointer(&perSfc[0])),
+	))
+
+	if errCode != Success {
+		return nil, fmt.Errorf(
+			"Could not count the ARTIO particles in the sfc range (%d, %d). " +
+			"Error Code: %d", sfcStart, sfcEnd, errCode,
+		)
+	}
+
+	return perSfc, nil
+}
+
 func (h Fileset) GetPositionsAt(
 	species int, sfcStart, sfcEnd int64, buf [][3]float32,
 ) error {
@@ -487,17 +695,12 @@ func (h Fileset) GetPositionsAt(
 	}
 
 	// This needs to be done with C callbacks for performance reasons.
-	// Furthermore, the global variables and locks are due to Go 1.6's
-	// new and terrible pointer passing rules.
-	
-	C.GetPositionsCallbackI = 0
-	C.GetPositionsCallbackN = C.int64_t(len(buf))
-
-	errCode := ErrorCode(C.artio_particle_read_sfc_range_species(
-		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd),
-		C.int(species), C.int(species),
-		(C.artio_particle_callback)(C.GetPositionsCallback),
-		unsafe.Pointer(&buf[0]),
+	// The callback state lives on the C stack of GetPositionsSfcRange, since
+	// Go memory passed to C may not hold Go pointers, so calls on separate
+	// filesets may run concurrently.
+	errCode := ErrorCode(C.GetPositionsSfcRange(
+		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd), C.int(species),
+		(*C.Vector)(unsafe.Pointer(&buf[0])), C.int64_t(len(buf)),
 	))
 
 	if errCode != Success {
@@ -515,7 +718,418 @@ func (h Fileset) GetPositions(
 ) ([][3]float32, error) {
 	counts, err := h.CountInRange(sfcStart, sfcEnd)
 	if err != nil { return nil, err }
+	// CountInRange only reads root cell headers, so the particles are
+	// decoded once.
 	buf := make([][3]float32, counts[species])
 	err = h.GetPositionsAt(species, sfcStart, sfcEnd, buf)
 	return buf, err
 }
+
+// SpeciesData holds the particles of one species in struct-of-arrays form,
+// with one slice per requested variable keyed by its label.
+type SpeciesData struct {
+	ID         []int64
+	Subspecies []int32
+	Primary    map[string][]float64
+	Secondary  map[string][]float32
+}
+
+func (h Fileset) speciesLabels(species int, kind string) []string {
+	name := fmt.Sprintf("species_%02d_%s_variable_labels", species, kind)
+	if !h.HasKey(name) { return nil }
+	return h.GetString(h.Key(name))
+}
+
+func labelIndex(labels []string, label string) int {
+	for i := range labels {
+		if labels[i] == label { return i }
+	}
+	return -1
+}
+
+// ReadSpecies reads the given variables of every particle of one species in
+// the sfc range [sfcStart, sfcEnd], or all of its variables if no fields are
+// given. The particles are read in a single C call rather than one call per
+// particle, so this should be preferred over ReadParticle for large reads.
+func (h Fileset) ReadSpecies(
+	sfcStart, sfcEnd int64, species int, fields ...string,
+) (*SpeciesData, error) {
+	numSpecies := int(h.GetInt(h.Key("num_particle_species"))[0])
+	if species < 0 || species >= numSpecies {
+		return nil, fmt.Errorf("ARTIO species %d does not exist.", species)
+	}
+
+	primaryLabels := h.speciesLabels(species, "primary")
+	secondaryLabels := h.speciesLabels(species, "secondary")
+	if len(fields) == 0 {
+		fields = append(append([]string{}, primaryLabels...), secondaryLabels...)
+	}
+
+	primaryIndex, secondaryIndex := []C.int{}, []C.int{}
+	primaryNames, secondaryNames := []string{}, []string{}
+	for _, field := range fields {
+		if i := labelIndex(primaryLabels, field); i >= 0 {
+			primaryIndex = append(primaryIndex, C.int(i))
+			primaryNames = append(primaryNames, field)
+		} else if i := labelIndex(secondaryLabels, field); i >= 0 {
+			secondaryIndex = append(secondaryIndex, C.int(i))
+			secondaryNames = append(secondaryNames, field)
+		} else {
+			return nil, fmt.Errorf(
+				"ARTIO species %d has no variable '%s'.", species, field,
+			)
+		}
+	}
+
+	counts, err := h.CountInRange(sfcStart, sfcEnd)
+	if err != nil { return nil, err }
+	n := counts[species]
+
+	data := &SpeciesData{
+		ID: make([]int64, n),
+		Subspecies: make([]int32, n),
+		Primary: map[string][]float64{},
+		Secondary: map[string][]float32{},
+	}
+	primary := make([]float64, int64(len(primaryIndex))*n)
+	secondary := make([]float32, int64(len(secondaryIndex))*n)
+	if n == 0 {
+		for _, name := range primaryNames { data.Primary[name] = primary }
+		for _, name := range secondaryNames { data.Secondary[name] = secondary }
+		return data, nil
+	}
+
+	var ptrPrimaryIndex, ptrSecondaryIndex *C.int
+	var ptrPrimary *C.double
+	var ptrSecondary *C.float
+	if len(primaryIndex) > 0 {
+		ptrPrimaryIndex = &primaryIndex[0]
+		ptrPrimary = (*C.double)(unsafe.Pointer(&primary[0]))
+	}
+	if len(secondaryIndex) > 0 {
+		ptrSecondaryIndex = &secondaryIndex[0]
+		ptrSecondary = (*C.float)(unsafe.Pointer(&secondary[0]))
+	}
+
+	errCode := ErrorCode(C.ReadSpecies(
+		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd), C.int(species),
+		C.int64_t(n), C.int(len(primaryIndex)), ptrPrimaryIndex,
+		C.int(len(secondaryIndex)), ptrSecondaryIndex,
+		(*C.int64_t)(unsafe.Pointer(&data.ID[0])),
+		(*C.int)(unsafe.Pointer(&data.Subspecies[0])),
+		ptrPrimary, ptrSecondary,
+	))
+	if errCode != Success {
+		return nil, fmt.Errorf(
+			"Could not read the ARTIO particles in the sfc range (%d, %d). " +
+			"Error Code: %d", sfcStart, sfcEnd, errCode,
+		)
+	}
+
+	for k, name := range primaryNames {
+		data.Primary[name] = primary[int64(k)*n : int64(k+1)*n]
+	}
+	for k, name := range secondaryNames {
+		data.Secondary[name] = secondary[int64(k)*n : int64(k+1)*n]
+	}
+
+	return data, nil
+}
+
+func (handle Fileset) OpenGrid() error {
+	err := ErrorCode(C.artio_fileset_open_grid(handle.ptr))
+	if err != Success {
+		return fmt.Errorf("Could not open ARTIO grid. ErrorCode = %d", err)
+	}
+	return nil
+}
+
+func (handle Fileset) CloseGrid() error {
+	err := ErrorCode(C.artio_fileset_close_grid(handle.ptr))
+	if err != Success {
+		return fmt.Errorf("Could not close ARTIO grid. ErrorCode = %d", err)
+	}
+	return nil
+}
+
+func (handle Fileset) GridCacheSfcRange(start, end int64) error {
+	err := ErrorCode(C.artio_grid_cache_sfc_range(
+		handle.ptr, C.int64_t(start), C.int64_t(end),
+	))
+
+	if err != Success {
+		return fmt.Errorf(
+			"Could not cache ARTIO grid sfc range (%d, %d). ErrorCode = %d",
+			start, end, err,
+		)
+	}
+	return nil
+}
+
+func (handle Fileset) GridClearSfcCache() error {
+	err := ErrorCode(C.artio_grid_clear_sfc_cache(handle.ptr))
+	if err != Success {
+		return fmt.Errorf(
+			"Could not clear ARTIO grid cache. ErrorCode = %d", err,
+		)
+	}
+	return nil
+}
+
+// GridReadRootCellBegin starts reading the root cell sfc, writing its
+// position and variables to pos and variables and the number of octs on
+// each of its levels to octsPerLevelBuf, which must hold grid_max_level
+// elements. It returns the number of levels in the root tree.
+func (handle Fileset) GridReadRootCellBegin(
+	sfc int64, pos []float64, variables []float32, octsPerLevelBuf []int32,
+) (int, error) {
+	numLevels := C.int(0)
+	ptrPos := (*C.double)(unsafe.Pointer(&pos[0]))
+	ptrVariables := (*C.float)(unsafe.Pointer(&variables[0]))
+	ptrOcts := (*C.int)(unsafe.Pointer(&octsPerLevelBuf[0]))
+
+	err := ErrorCode(C.artio_grid_read_root_cell_begin(
+		handle.ptr, C.int64_t(sfc), ptrPos, ptrVariables, &numLevels, ptrOcts,
+	))
+
+	if err != Success {
+		return 0, fmt.Errorf(
+			"Could not read ARTIO grid sfc %d. ErrorCode = %d", sfc, err,
+		)
+	}
+	return int(numLevels), nil
+}
+
+func (handle Fileset) GridReadRootCellEnd() error {
+	err := ErrorCode(C.artio_grid_read_root_cell_end(handle.ptr))
+	if err != Success {
+		return fmt.Errorf(
+			"Could not complete reading ARTIO grid sfc. ErrorCode = %d", err,
+		)
+	}
+	return nil
+}
+
+func (handle Fileset) GridReadLevelBegin(level int) error {
+	err := ErrorCode(C.artio_grid_read_level_begin(handle.ptr, C.int(level)))
+	if err != Success {
+		return fmt.Errorf(
+			"Could not begin to read grid level %d. ErrorCode = %d", level, err,
+		)
+	}
+	return nil
+}
+
+func (handle Fileset) GridReadLevelEnd() error {
+	err := ErrorCode(C.artio_grid_read_level_end(handle.ptr))
+	if err != Success {
+		return fmt.Errorf(
+			"Could not complete reading ARTIO grid level. ErrorCode = %d", err,
+		)
+	}
+	return nil
+}
+
+// GridReadOct reads the next oct of the current level. variables must hold
+// 8*num_grid_variables elements and refined 8 elements.
+func (handle Fileset) GridReadOct(
+	pos []float64, variables []float32, refined []int32,
+) error {
+	ptrPos := (*C.double)(unsafe.Pointer(&pos[0]))
+	ptrVariables := (*C.float)(unsafe.Pointer(&variables[0]))
+	ptrRefined := (*C.int)(unsafe.Pointer(&refined[0]))
+
+	err := ErrorCode(C.artio_grid_read_oct(
+		handle.ptr, ptrPos, ptrVariables, ptrRefined,
+	))
+	if err != Success {
+		return fmt.Errorf("Could not read ARTIO oct. ErrorCode = %d", err)
+	}
+	return nil
+}
+
+// CellData holds grid cells in struct-of-arrays form, with one slice per
+// requested variable keyed by its label. Positions are in root cell units.
+type CellData struct {
+	Pos       [][3]float64
+	Level     []int32
+	Refined   []int32
+	Variables map[string][]float32
+}
+
+// GridCountInRange returns the number of cells on levels [minLevel,
+// maxLevel] in the sfc range [sfcStart, sfcEnd]. Only the root cell headers
+// are read.
+func (h Fileset) GridCountInRange(
+	sfcStart, sfcEnd int64, minLevel, maxLevel int,
+) (int64, error) {
+	n := int64(0)
+	errCode := ErrorCode(C.CountCellsSfcRange(
+		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd),
+		C.int(minLevel), C.int(maxLevel), (*C.int64_t)(unsafe.Pointer(&n)),
+	))
+
+	if errCode != Success {
+		return 0, fmt.Errorf(
+			"Could not count the ARTIO cells in the sfc range (%d, %d). " +
+			"Error Code: %d", sfcStart, sfcEnd, errCode,
+		)
+	}
+	return n, nil
+}
+
+// ReadCells reads the cells selected by option on levels [minLevel,
+// maxLevel] of the sfc range [sfcStart, sfcEnd], with the given variables,
+// or all of them if no fields are given. maxLevel is clipped to the deepest
+// level in the fileset. The cells are read in a single C call after a scan
+// of the root cell headers sizes the buffers.
+func (h Fileset) ReadCells(
+	sfcStart, sfcEnd int64, minLevel, maxLevel int, option ReadOption,
+	fields ...string,
+) (*CellData, error) {
+	if maxLevel > int(h.GetInt(h.Key("grid_max_level"))[0]) {
+		maxLevel = int(h.GetInt(h.Key("grid_max_level"))[0])
+	}
+
+	labels := h.GetString(h.Key("grid_variable_labels"))
+	if len(fields) == 0 { fields = labels }
+
+	index := []C.int{}
+	for _, field := range fields {
+		i := labelIndex(labels, field)
+		if i < 0 {
+			return nil, fmt.Errorf("ARTIO grid has no variable '%s'.", field)
+		}
+		index = append(index, C.int(i))
+	}
+
+	// An upper bound when only leaves or refined cells are read.
+	n, err := h.GridCountInRange(sfcStart, sfcEnd, minLevel, maxLevel)
+	if err != nil { return nil, err }
+
+	data := &CellData{
+		Pos: make([][3]float64, n),
+		Level: make([]int32, n),
+		Refined: make([]int32, n),
+		Variables: map[string][]float32{},
+	}
+	variables := make([]float32, int64(len(index))*n)
+
+	var ptrPos *C.double
+	var ptrLevel, ptrRefined, ptrIndex *C.int
+	var ptrVariables *C.float
+	if n > 0 {
+		ptrPos = (*C.double)(unsafe.Pointer(&data.Pos[0]))
+		ptrLevel = (*C.int)(unsafe.Pointer(&data.Level[0]))
+		ptrRefined = (*C.int)(unsafe.Pointer(&data.Refined[0]))
+		if len(index) > 0 {
+			ptrIndex = &index[0]
+			ptrVariables = (*C.float)(unsafe.Pointer(&variables[0]))
+		}
+	}
+
+	numCells := int64(0)
+	errCode := ErrorCode(C.GetCellsSfcRange(
+		h.ptr, C.int64_t(sfcStart), C.int64_t(sfcEnd),
+		C.int(minLevel), C.int(maxLevel), C.int(option),
+		ptrPos, ptrLevel, ptrRefined,
+		C.int(len(index)), ptrIndex, ptrVariables,
+		C.int64_t(n), (*C.int64_t)(unsafe.Pointer(&numCells)),
+	))
+	if errCode != Success {
+		return nil, fmt.Errorf(
+			"Could not read the ARTIO cells in the sfc range (%d, %d). " +
+			"Error Code: %d", sfcStart, sfcEnd, errCode,
+		)
+	}
+
+	data.Pos = data.Pos[:numCells]
+	data.Level = data.Level[:numCells]
+	data.Refined = data.Refined[:numCells]
+	for k, name := range fields {
+		data.Variables[name] = variables[int64(k)*n : int64(k)*n + numCells]
+	}
+
+	return data, nil
+}
+
+// ParallelReadFunc processes the sfc range ranges[i] with a Fileset owned
+// by the calling worker. Results should be written to memory which no
+// other range writes to, e.g. element i of a slice.
+type ParallelReadFunc func(h Fileset, i int, sfcStart, sfcEnd int64) error
+
+// ParallelRead calls fn on each of the given sfc ranges from workers
+// goroutines. Each worker opens its own Fileset on prefix with flag, since
+// the C library keeps read state per handle, and caches each of its ranges
+// in the grid and particle components it opened before calling fn. The
+// first error encountered is returned; ranges not yet started when it
+// occurs are skipped.
+func ParallelRead(
+	prefix string, flag OpenType, ranges [][2]int64, workers int,
+	fn ParallelReadFunc,
+) error {
+	if workers < 1 { workers = 1 }
+	if workers > len(ranges) { workers = len(ranges) }
+
+	jobs := make(chan int, len(ranges))
+	for i := range ranges { jobs <- i }
+	close(jobs)
+
+	errs := make(chan error, workers)
+	for w := 0; w < workers; w++ {
+		go func() {
+			errs <- parallelReadWorker(prefix, flag, ranges, jobs, fn)
+		}()
+	}
+
+	var err error
+	for w := 0; w < workers; w++ {
+		if werr := <-errs; werr != nil && err == nil {
+			err = werr
+			// Drain the remaining ranges so that other workers stop early.
+			for range jobs { }
+		}
+	}
+	return err
+}
+
+func parallelReadWorker(
+	prefix string, flag OpenType, ranges [][2]int64, jobs <-chan int,
+	fn ParallelReadFunc,
+) (err error) {
+	h, err := FilesetOpen(prefix, flag, NullContext)
+	if err != nil { return err }
+	defer func() {
+		if cerr := h.Close(); cerr != nil && err == nil { err = cerr }
+	}()
+
+	for i := range jobs {
+		start, end := ranges[i][0], ranges[i][1]
+		if flag&OpenGrid != 0 {
+			err = h.GridCacheSfcRange(start, end)
+			if err != nil { return err }
+		}
+		if flag&OpenParticles != 0 {
+			err = h.ParticleCacheSfcRange(start, end)
+			if err != nil {
+				if flag&OpenGrid != 0 { h.GridClearSfcCache() }
+				return err
+			}
+		}
+
+		err = fn(h, i, start, end)
+
+		if flag&OpenGrid != 0 {
+			if cerr := h.GridClearSfcCache(); cerr != nil && err == nil {
+				err = cerr
+			}
+		}
+		if flag&OpenParticles != 0 {
+			if cerr := h.ParticleClearSfcCache(); cerr != nil && err == nil {
+				err = cerr
+			}
+		}
+		if err != nil { return err }
+	}
+	return nil
+}
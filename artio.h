@@ -25,6 +25,10 @@
 
 #define ARTIO_MAJOR_VERSION     1
 #define ARTIO_MINOR_VERSION     2
+/* major version recorded by filesets which older readers cannot decode
+ * (compressed grid data, packed refined flags, reduced particle variable
+ * storage); readable by this library */
+#define ARTIO_COMPRESSED_MAJOR_VERSION  2
 
 #ifdef ARTIO_MPI
 #include <mpi.h>
@@ -63,6 +67,18 @@ typedef __int64 int64_t;
 #endif
 #define ARTIO_ALLOC_MANUAL                  4
 
+/* grid compression, selected by the "grid_compression" parameter */
+#define ARTIO_GRID_COMPRESSION_NONE         0
+#define ARTIO_GRID_COMPRESSION_LZ           1
+
+/* particle variable storage, selected per variable by the integer array
+ * parameters "species_%02u_primary_variable_storage" and
+ * "species_%02u_secondary_variable_storage" */
+#define ARTIO_STORAGE_NATIVE                0
+#define ARTIO_STORAGE_DOUBLE                1
+#define ARTIO_STORAGE_FLOAT                 2
+#define ARTIO_STORAGE_HALF                  3
+
 /* artio sfc types */
 #define ARTIO_SFC_SLAB_X                    0
 #define ARTIO_SFC_MORTON                    1
@@ -110,6 +126,7 @@ typedef __int64 int64_t;
 #define ARTIO_ERR_INVALID_CELL_TYPES        115
 #define ARTIO_ERR_INVALID_BUFFER_SIZE       116
 #define ARTIO_ERR_INVALID_INDEX             117
+#define ARTIO_ERR_INVALID_COMPRESSION       118
 
 #define ARTIO_ERR_DATA_EXISTS               200
 #define ARTIO_ERR_INSUFFICIENT_DATA         201
@@ -177,11 +194,19 @@ artio_fileset *artio_fileset_create(char * file_prefix,
  */
 int artio_fileset_close(artio_fileset *handle);
 int artio_fileset_set_buffer_size( int buffer_size );
+int artio_fileset_set_async_buffers( int num_buffers );
 int artio_fileset_has_grid( artio_fileset *handle );
 int artio_fileset_has_particles( artio_fileset *handle );
+/* range of root cell indices addressed by the handle or forked writer */
+int artio_fileset_get_sfc_range( artio_fileset *handle,
+		int64_t *sfc_begin, int64_t *sfc_end );
 
 /* public parameter interface */
 int artio_parameter_iterate( artio_fileset *handle, char *key, int *type, int *length );
+/* as artio_parameter_iterate, but the position is kept in *cursor (NULL to
+ * start) rather than the handle, so concurrent enumerations do not interfere */
+int artio_parameter_iterate_r( artio_fileset *handle, void **cursor,
+		char *key, int *type, int *length );
 int artio_parameter_get_array_length(artio_fileset *handle, const char *key, int *length);
 int artio_parameter_get_type(artio_fileset *handle, const char *key, int *type);
 
@@ -238,6 +263,14 @@ int artio_parameter_get_long_array_index(artio_fileset *handle, const char *key,
 int artio_parameter_copy(artio_fileset *src, artio_fileset *dest, const char *key);
 int artio_parameter_has_key(artio_fileset *handle, const char *key);
 
+/*
+ * Copy every parameter into one buffer allocated with malloc, to be freed
+ * by the caller.  Each parameter is stored as its NUL terminated key, an
+ * int32 type and an int32 byte count, then its values in host byte order
+ * (string arrays as consecutive NUL terminated strings).
+ */
+int artio_parameter_pack(artio_fileset *handle, char **buffer, int64_t *size);
+
 /* public grid interface */
 typedef void (* artio_grid_callback)( int64_t sfc_index, int level,
 		double *pos, float *variables, int *refined, void *params );
@@ -250,6 +283,18 @@ typedef void (* artio_grid_callback)( int64_t sfc_index, int level,
  *  allocation_strategy       How to apportion sfc indices to each grid file
  *  num_grid_variables        The number of variables per cell
  *  grid_variable_labels      Identifying labels for each variable
+ *
+ * If the integer parameter "grid_compression" has been set to
+ * ARTIO_GRID_COMPRESSION_LZ, root trees are stored compressed: refined
+ * flags as one bit per cell and variables through a lossless float
+ * predictor and LZ coder.  Root cells must then be added in increasing
+ * sfc order, and the fileset is marked ARTIO_COMPRESSED_MAJOR_VERSION so
+ * older readers refuse it.  Not available with ARTIO_MPI.
+ *
+ * If the integer parameter "grid_packed_refined" has been set to 1, the
+ * refined flags of each oct are stored as a one byte mask (bit i for cell
+ * i) rather than eight ints, and the fileset is likewise marked
+ * ARTIO_COMPRESSED_MAJOR_VERSION.
  */
 int artio_fileset_add_grid(artio_fileset *handle,
 		int num_grid_files, int allocation_strategy,
@@ -263,6 +308,31 @@ int artio_fileset_commit_grid( artio_fileset *handle );
 int artio_fileset_open_grid(artio_fileset *handle);
 int artio_fileset_close_grid(artio_fileset *handle);
 
+/*
+ * Description:	Split the remaining root cells of a committed grid into
+ *				num_writers handles owning disjoint sets of files, which may
+ *				then be written concurrently from separate threads (not
+ *				available with ARTIO_MPI).  Each writer accepts the root cells
+ *				in its artio_fileset_get_sfc_range, in the order they were
+ *				added; writers must be released with artio_grid_join_writers
+ *				and never closed directly.  The root cells must have been
+ *				added in increasing sfc order (ARTIO_ERR_INVALID_SFC).
+ */
+int artio_grid_fork_writers(artio_fileset *handle, int num_writers,
+		artio_fileset **writers);
+int artio_grid_join_writers(artio_fileset *handle, int num_writers,
+		artio_fileset **writers);
+
+/*
+ * Description:	Copy root cells [start,end] from a fileset open for reading
+ *				into one being written without decoding them.  The root
+ *				cells must be the next ones expected by dest and declared
+ *				with the same levels and octs (particle counts) as in src.
+ *				Compressed grids are refused (ARTIO_ERR_INVALID_COMPRESSION).
+ */
+int artio_grid_copy_root_cells(artio_fileset *src, artio_fileset *dest,
+		int64_t start, int64_t end);
+
 /*
  * Description:         Output the variables of the root level cell and the hierarchy
  *                      of the Oct tree associated with this root level cell
@@ -299,6 +369,18 @@ int artio_grid_write_level_end(artio_fileset *handle);
  */
 int artio_grid_write_oct(artio_fileset *handle, float *variables, int *refined);
 
+/*
+ * Description:         Output every oct of a level at once, in place of
+ *                      write_level_begin, write_oct and write_level_end
+ *
+ *  handle              The handle of the file
+ *  level               The level being written
+ *  variables           The variables of all octs on the level, [num_octs][8][num_grid_variables]
+ *  refined             The refinement flags of all octs on the level, [num_octs][8]
+ */
+int artio_grid_write_level_bulk(artio_fileset *handle, int level,
+		float *variables, int *refined);
+
 /*
  * Description:         Read the variables of the root level cell and the hierarchy of the Octtree
  *                      correlated with this root level cell
@@ -337,12 +419,21 @@ int artio_grid_read_oct(artio_fileset *handle, double *pos,
 int artio_grid_cache_sfc_range(artio_fileset *handle, int64_t sfc_start, int64_t sfc_end);
 int artio_grid_clear_sfc_cache(artio_fileset *handle );
 
+/*
+ * Number of octs in each root tree of [start,end], or in all of them.
+ * Filesets written by this library record these in <prefix>.goct, so
+ * counting reads nothing else; for older filesets they are recovered
+ * from the offset tables and root tree headers of the range.
+ */
 int artio_grid_octs_in_sfc_range(artio_fileset *handle,
 		int64_t start, int64_t end, int64_t *num_octs_per_sfc );
 
 int artio_grid_total_octs_in_sfc_range(artio_fileset *handle,
 		int64_t start, int64_t end, int64_t *num_octs_in_range );
 
+int artio_grid_count_octs_per_level(artio_fileset *handle,
+		int64_t *num_octs_per_level );
+
 /*
  * Description:       Read a segment of oct nodes
  *
@@ -385,6 +476,16 @@ int artio_grid_read_selection_levels( artio_fileset *handle,
  *  species_labels      string identifier for each species
  *  handle              the artio file handle
  */
+/*
+ * Description: Add a particle component to a fileset open for writing
+ *
+ * Variables are stored as double (primary) and float (secondary) unless
+ * the storage parameters for a species have been set, one ARTIO_STORAGE_*
+ * value per variable.  Narrower storage is rounded to nearest when
+ * written and widened back into the same double and float buffers when
+ * read; any storage other than ARTIO_STORAGE_NATIVE marks the fileset
+ * ARTIO_COMPRESSED_MAJOR_VERSION so older readers refuse it.
+ */
 int artio_fileset_add_particles(artio_fileset *handle,
 		int num_particle_files, int allocation_strategy,
 		int num_species, char **species_labels,
@@ -399,6 +500,13 @@ int artio_fileset_commit_particles( artio_fileset *handle );
 
 int artio_fileset_open_particles(artio_fileset *handle);
 int artio_fileset_close_particles(artio_fileset *handle);
+int artio_particle_fork_writers(artio_fileset *handle, int num_writers,
+		artio_fileset **writers);
+int artio_particle_join_writers(artio_fileset *handle, int num_writers,
+		artio_fileset **writers);
+
+int artio_particle_copy_root_cells(artio_fileset *src, artio_fileset *dest,
+		int64_t start, int64_t end);
 
 /*
  * Description:     Output the variables of the root level cell and the hierarchy of
@@ -437,6 +545,21 @@ int artio_particle_write_species_end(artio_fileset *handle);
 int artio_particle_write_particle(artio_fileset *handle, int64_t pid, int subspecies,
 			double *primary_variables, float *secondary_variables);
 
+/*
+ * Description: Output every particle of a species at once, in place of
+ *              write_species_begin, write_particle and write_species_end
+ *
+ * handle               The handle of the file
+ * species              The species being written
+ * pid                  The particle ids, [num_particles]
+ * subspecies           The particle subspecies, [num_particles]
+ * primary_variables    The primary variables, [num_primary_variables][num_particles]
+ * secondary_variables  The secondary variables, [num_secondary_variables][num_particles]
+ */
+int artio_particle_write_species_bulk(artio_fileset *handle, int species,
+			int64_t *pid, int *subspecies,
+			double *primary_variables, float *secondary_variables);
+
 /*
  * Description: Read the variables of the root level cell and the hierarchy of the Octtree
  *              correlated with this root level cell
@@ -474,6 +597,16 @@ int artio_particle_read_particle(artio_fileset *handle, int64_t *pid, int *subsp
 int artio_particle_cache_sfc_range(artio_fileset *handle, int64_t sfc_start, int64_t sfc_end);
 int artio_particle_clear_sfc_cache(artio_fileset *handle );
 
+/*
+ * Description: Count the particles of each species in root cells
+ *              [start,end] from the root cell headers, without reading
+ *              any particles.  If num_particles_per_sfc is not NULL it
+ *              receives the num_species counts of each root cell in turn.
+ */
+int artio_particle_count_in_sfc_range(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *num_particles_per_species,
+		int *num_particles_per_sfc );
+
 typedef void (* artio_particle_callback)(int64_t sfc_index,
 		int species, int subspecies, int64_t pid,
 		double *primary_variables, float *secondary_variables, void *params );
@@ -513,38 +646,24 @@ artio_selection *artio_selection_allocate( artio_fileset *handle );
 artio_selection *artio_select_all( artio_fileset *handle );
 artio_selection *artio_select_volume( artio_fileset *handle, double lpos[3], double rpos[3] );
 artio_selection *artio_select_cube( artio_fileset *handle, double center[3], double size );
+/* adding cells discards the bounds of a volume or cube selection, whose
+ * octs are then no longer pruned to that volume */
 int artio_selection_add_root_cell( artio_selection *selection, int coords[3] );
+int artio_selection_add_range( artio_selection *selection, int64_t start, int64_t end );
+int artio_selection_add_sfc_list( artio_selection *selection,
+		int64_t *sfc_list, int64_t num_sfcs );
 int artio_selection_destroy( artio_selection *selection );
+artio_selection *artio_selection_union( artio_selection *a, artio_selection *b );
+artio_selection *artio_selection_intersect( artio_selection *a, artio_selection *b );
+artio_selection *artio_selection_subtract( artio_selection *a, artio_selection *b );
+/* weights come from the file offset tables, read through the grid and
+ * particle sfc caches; the ranges cached beforehand are cached again */
+int artio_selection_partition( artio_selection *selection, int num_parts,
+		int open_type, artio_selection **parts );
 void artio_selection_print( artio_selection *selection );
 int artio_selection_iterator( artio_selection *selection,
 		int64_t max_range_size, int64_t *start, int64_t *end );
 int artio_selection_iterator_reset( artio_selection *selection );
 int64_t artio_selection_size( artio_selection *selection );
 
-/* CGo Callbacks */
-
-/* `CountCallback` counts the number of particles of each species in a range.
- * `params` is a zeroed int64_t array that output will be written to. */
-int CountCallback(
-	int64_t sfc_index, int species, int subspecies, int64_t pid,
-	double *primary_variables, float *secondary_variables, void *params
-);
-
-/* `GetPositionsCallback` reads the positions in a range to a buffer.
- * `params` is a pointer to a PositionBuffer struct. */
-int GetPositionsCallback(
-    int64_t sfx_idx, int species, int subspecies, int64_t pid,
-    double *primary_variables, float *secondary_variables, void *params
-);
-
-/* `Vector` is only defined to make CGo casts easier. */
-typedef float Vector[3];
-
-/* `PositionBuffer` is a helper type for `WritePositionsCallback` which
- * contains the output buffer and also allows for bounds checking. */
-typedef struct PositionBuffer {
-    Vector *buf;
-    int64_t n, i;
-} PositionBuffer;
-
 #endif /* __ARTIO_H__ */
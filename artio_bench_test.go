@@ -0,0 +1,155 @@
+package artio
+
+import (
+	"fmt"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"sync"
+	"testing"
+)
+
+// The benchmarks read the fileset named by ARTIO_BENCH_FILESET. When it is
+// unset, a fileset is written on first use by
+// cart_utilities/artio_utilities/artio_generate, built with the C compiler
+// cgo uses, and removed once the benchmarks finish.
+
+var (
+	benchOnce sync.Once
+	benchDir string
+	benchPrefix string
+	benchErr error
+)
+
+func TestMain(m *testing.M) {
+	code := m.Run()
+	if benchDir != "" { os.RemoveAll(benchDir) }
+	os.Exit(code)
+}
+
+// generateFileset builds artio_generate against the package sources and
+// writes its default fileset into a temporary directory.
+func generateFileset() (string, error) {
+	dir, err := os.MkdirTemp("", "artio_bench")
+	if err != nil { return "", err }
+	benchDir = dir
+
+	sources, err := filepath.Glob("artio*.c")
+	if err != nil { return "", err }
+	cc := os.Getenv("CC")
+	if cc == "" { cc = "cc" }
+
+	gen := filepath.Join(dir, "artio_generate")
+	args := append([]string{"-O2", "-I."}, sources...)
+	args = append(args, filepath.Join("cart_utilities", "artio_utilities",
+		"artio_generate.c"), "-o", gen, "-lm", "-lpthread")
+	if out, err := exec.Command(cc, args...).CombinedOutput(); err != nil {
+		return "", fmt.Errorf("building artio_generate: %v\n%s", err, out)
+	}
+
+	prefix := filepath.Join(dir, "bench")
+	if out, err := exec.Command(gen, prefix).CombinedOutput(); err != nil {
+		return "", fmt.Errorf("running artio_generate: %v\n%s", err, out)
+	}
+	return prefix, nil
+}
+
+func benchFileset(b *testing.B) string {
+	benchOnce.Do(func() {
+		benchPrefix = os.Getenv("ARTIO_BENCH_FILESET")
+		if benchPrefix == "" { benchPrefix, benchErr = generateFileset() }
+	})
+	if benchErr != nil { b.Skip(benchErr) }
+	return benchPrefix
+}
+
+// filesetFlags returns the components the fileset at prefix contains.
+func filesetFlags(prefix string) (OpenType, error) {
+	h, err := FilesetOpen(prefix, 0, NullContext)
+	if err != nil { return 0, err }
+	defer h.Close()
+
+	flag := OpenType(0)
+	if h.HasKey("num_particle_species") { flag |= OpenParticles }
+	if h.HasKey("num_grid_variables") { flag |= OpenGrid }
+	return flag, nil
+}
+
+// benchOpenFileset opens the benchmark fileset with the components in need,
+// skipping the benchmark if it lacks any of them.
+func benchOpenFileset(b *testing.B, need OpenType) (Fileset, int64) {
+	prefix := benchFileset(b)
+	flag, err := filesetFlags(prefix)
+	if err != nil { b.Fatal(err) }
+	if flag&need != need { b.Skip("fileset lacks the component benchmarked") }
+
+	h, err := FilesetOpen(prefix, need, NullContext)
+	if err != nil { b.Fatal(err) }
+	return h, h.GetLong(h.Key("num_root_cells"))[0]
+}
+
+func BenchmarkOpen(b *testing.B) {
+	prefix := benchFileset(b)
+	flag, err := filesetFlags(prefix)
+	if err != nil { b.Fatal(err) }
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		h, err := FilesetOpen(prefix, flag, NullContext)
+		if err != nil { b.Fatal(err) }
+		h.Close()
+	}
+}
+
+func BenchmarkHeader(b *testing.B) {
+	h, _ := benchOpenFileset(b, 0)
+	defer h.Close()
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, err := h.Header(); err != nil { b.Fatal(err) }
+	}
+}
+
+func BenchmarkCountInRange(b *testing.B) {
+	h, roots := benchOpenFileset(b, OpenParticles)
+	defer h.Close()
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, err := h.CountInRange(0, roots - 1); err != nil { b.Fatal(err) }
+	}
+}
+
+func BenchmarkGetPositions(b *testing.B) {
+	h, roots := benchOpenFileset(b, OpenParticles)
+	defer h.Close()
+
+	counts, err := h.CountInRange(0, roots - 1)
+	if err != nil { b.Fatal(err) }
+
+	for species := range counts {
+		b.Run(fmt.Sprint(species), func(b *testing.B) {
+			buf := make([][3]float32, counts[species])
+			b.SetBytes(int64(len(buf)) * 12)
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				err := h.GetPositionsAt(species, 0, roots - 1, buf)
+				if err != nil { b.Fatal(err) }
+			}
+		})
+	}
+}
+
+func BenchmarkReadCells(b *testing.B) {
+	h, roots := benchOpenFileset(b, OpenGrid)
+	defer h.Close()
+
+	maxLevel := h.GetInt(h.Key("grid_max_level"))
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		_, err := h.ReadCells(0, roots - 1, 0, int(maxLevel[0]), ReadLeafs)
+		if err != nil { b.Fatal(err) }
+	}
+}
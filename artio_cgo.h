@@ -0,0 +1,92 @@
+/* Declarations of the C helpers used by the Go bindings in artio.go and
+ * defined in artio_cgo_callbacks.c.  They are not part of the artio
+ * library and only the bindings include this header. */
+
+#ifndef __ARTIO_CGO_H__
+#define __ARTIO_CGO_H__
+
+#include "artio.h"
+
+/* `CountCallback` counts the number of particles of each species in a range.
+ * `params` is a zeroed int64_t array that output will be written to. */
+int CountCallback(
+	int64_t sfc_index, int species, int subspecies, int64_t pid,
+	double *primary_variables, float *secondary_variables, void *params
+);
+
+/* `GetPositionsCallback` reads the positions in a range to a buffer.
+ * `params` is a pointer to a PositionBuffer struct. */
+int GetPositionsCallback(
+    int64_t sfx_idx, int species, int subspecies, int64_t pid,
+    double *primary_variables, float *secondary_variables, void *params
+);
+
+/* `ReadSpecies` reads the particles of one species in the root cells
+ * [sfc1, sfc2] into struct-of-arrays buffers holding n particles. Primary
+ * variable primary_index[k] is written to primary + k*n, and
+ * likewise for secondary variables; ids and subspecies may be NULL. */
+int ReadSpecies(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2, int species,
+	int64_t n, int num_primary, int *primary_index,
+	int num_secondary, int *secondary_index,
+	int64_t *ids, int *subspecies, double *primary, float *secondary
+);
+
+/* `Vector` is only defined to make CGo casts easier. */
+typedef float Vector[3];
+
+/* `PositionBuffer` is a helper type for `GetPositionsCallback` which
+ * contains the output buffer and also allows for bounds checking. */
+typedef struct PositionBuffer {
+    Vector *buf;
+    int64_t n, i;
+} PositionBuffer;
+
+/* `GetPositionsSfcRange` reads the positions of one species in the root
+ * cells [sfc1, sfc2] into the n elements of buf, keeping the callback
+ * state on the stack so that calls may run concurrently. */
+int GetPositionsSfcRange(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2, int species,
+	Vector *buf, int64_t n
+);
+
+/* `CellBuffer` is a helper type for `GetCellsCallback` which contains the
+ * output buffers of n cells and also allows for bounds checking. Variable
+ * variable_index[k] of cell i is written to variables[k*n + i]. */
+typedef struct CellBuffer {
+	double *pos;
+	int *level;
+	int *refined;
+	float *variables;
+	int num_variables;
+	int *variable_index;
+	int64_t n, i;
+} CellBuffer;
+
+/* `GetCellsCallback` copies the cells of a range to a buffer.
+ * `params` is a pointer to a CellBuffer struct. */
+void GetCellsCallback(
+	int64_t sfc_index, int level, double *pos, float *variables,
+	int *refined, void *params
+);
+
+/* `CountCellsSfcRange` counts the cells on levels [min_level, max_level]
+ * of the root cells [sfc1, sfc2] from the root cell headers. */
+int CountCellsSfcRange(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2,
+	int min_level, int max_level, int64_t *count
+);
+
+/* `GetCellsSfcRange` reads the cells selected by options on levels
+ * [min_level, max_level] of the root cells [sfc1, sfc2] into the buffers
+ * of a CellBuffer built on the stack, so that calls may run concurrently.
+ * The number of cells read is written to num_cells. */
+int GetCellsSfcRange(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2,
+	int min_level, int max_level, int options,
+	double *pos, int *level, int *refined,
+	int num_variables, int *variable_index, float *variables,
+	int64_t n, int64_t *num_cells
+);
+
+#endif /* __ARTIO_CGO_H__ */
@@ -0,0 +1,235 @@
+/* This file does not belong to the artio library. It holds the C helpers
+ * used by the Go bindings in artio.go, which cgo compiles along with the
+ * library sources; they are declared in artio_cgo.h.  ARTIO_CGO is only
+ * defined by the cgo flags in artio.go, so C builds of the library
+ * sources that pick up this file compile it empty. */
+
+#ifdef ARTIO_CGO
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "artio_cgo.h"
+
+int CountCallback(
+	int64_t sfc_index, int species, int subspecies, int64_t pid,
+	double *primary_variables, float *secondary_variables, void *params
+) {
+	int64_t *counts = (int64_t *) params;
+	counts[species]++;
+	return 0;
+}
+
+int GetPositionsCallback(
+    int64_t sfx_idx, int species, int subspecies, int64_t pid,
+    double *primary_variables, float *secondary_variables, void *params
+) {
+	PositionBuffer *pb;
+
+    pb = (PositionBuffer*) params;
+    if (pb->i >= pb->n) {
+		pb->i++;
+		return ARTIO_ERR_INVALID_SFC_RANGE;
+	}
+
+    pb->buf[pb->i][0] = primary_variables[0];
+    pb->buf[pb->i][1] = primary_variables[1];
+    pb->buf[pb->i][2] = primary_variables[2];
+	
+    pb->i++;
+	
+    return 0;
+}
+
+int GetPositionsSfcRange(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2, int species,
+	Vector *buf, int64_t n
+) {
+	int ret;
+	PositionBuffer pb;
+
+	pb.buf = buf;
+	pb.n = n;
+	pb.i = 0;
+
+	ret = artio_particle_read_sfc_range_species(handle, sfc1, sfc2,
+		species, species, (artio_particle_callback)GetPositionsCallback, &pb);
+	if (ret == ARTIO_SUCCESS && pb.i > pb.n) {
+		ret = ARTIO_ERR_INVALID_SFC_RANGE;
+	}
+	return ret;
+}
+
+int ReadSpecies(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2, int species,
+	int64_t n, int num_primary, int *primary_index,
+	int num_secondary, int *secondary_index,
+	int64_t *ids, int *subspecies, double *primary, float *secondary
+) {
+	int ret, num_species, k, sub;
+	int64_t sfc, i, j, pid;
+	int *counts = NULL, *num_variables = NULL;
+	double *primary_variables = NULL;
+	float *secondary_variables = NULL;
+
+	ret = artio_parameter_get_int(handle, "num_particle_species", &num_species);
+	if (ret != ARTIO_SUCCESS) { return ret; }
+	if (species < 0 || species >= num_species) { return ARTIO_ERR_INVALID_SPECIES; }
+
+	counts = (int *) malloc(num_species * sizeof(int));
+	num_variables = (int *) malloc(2 * num_species * sizeof(int));
+	if (counts == NULL || num_variables == NULL) {
+		ret = ARTIO_ERR_MEMORY_ALLOCATION;
+		goto cleanup;
+	}
+
+	ret = artio_parameter_get_int_array(handle, "num_primary_variables",
+		num_species, num_variables);
+	if (ret != ARTIO_SUCCESS) { goto cleanup; }
+	ret = artio_parameter_get_int_array(handle, "num_secondary_variables",
+		num_species, num_variables + num_species);
+	if (ret != ARTIO_SUCCESS) { goto cleanup; }
+
+	primary_variables = (double *) malloc(
+		(num_variables[species] + 1) * sizeof(double));
+	secondary_variables = (float *) malloc(
+		(num_variables[num_species + species] + 1) * sizeof(float));
+	if (primary_variables == NULL || secondary_variables == NULL) {
+		ret = ARTIO_ERR_MEMORY_ALLOCATION;
+		goto cleanup;
+	}
+
+	ret = artio_particle_cache_sfc_range(handle, sfc1, sfc2);
+	if (ret != ARTIO_SUCCESS) { goto cleanup; }
+
+	i = 0;
+	for (sfc = sfc1; sfc <= sfc2; sfc++) {
+		ret = artio_particle_read_root_cell_begin(handle, sfc, counts);
+		if (ret != ARTIO_SUCCESS) { goto cleanup; }
+
+		if (counts[species] > 0) {
+			if (i + counts[species] > n) {
+				ret = ARTIO_ERR_INVALID_SFC_RANGE;
+				goto cleanup;
+			}
+
+			ret = artio_particle_read_species_begin(handle, species);
+			if (ret != ARTIO_SUCCESS) { goto cleanup; }
+
+			for (j = 0; j < counts[species]; j++, i++) {
+				ret = artio_particle_read_particle(handle, &pid, &sub,
+					primary_variables, secondary_variables);
+				if (ret != ARTIO_SUCCESS) { goto cleanup; }
+
+				if (ids != NULL) { ids[i] = pid; }
+				if (subspecies != NULL) { subspecies[i] = sub; }
+				for (k = 0; k < num_primary; k++) {
+					primary[k*n + i] = primary_variables[primary_index[k]];
+				}
+				for (k = 0; k < num_secondary; k++) {
+					secondary[k*n + i] = secondary_variables[secondary_index[k]];
+				}
+			}
+
+			ret = artio_particle_read_species_end(handle);
+			if (ret != ARTIO_SUCCESS) { goto cleanup; }
+		}
+
+		ret = artio_particle_read_root_cell_end(handle);
+		if (ret != ARTIO_SUCCESS) { goto cleanup; }
+	}
+
+cleanup:
+	free(counts);
+	free(num_variables);
+	free(primary_variables);
+	free(secondary_variables);
+	return ret;
+}
+
+void GetCellsCallback(
+	int64_t sfc_index, int level, double *pos, float *variables,
+	int *refined, void *params
+) {
+	int k;
+	int64_t i;
+	CellBuffer *cb;
+
+	cb = (CellBuffer*) params;
+	i = cb->i++;
+	if (i >= cb->n) { return; }
+
+	cb->pos[3*i + 0] = pos[0];
+	cb->pos[3*i + 1] = pos[1];
+	cb->pos[3*i + 2] = pos[2];
+	cb->level[i] = level;
+	cb->refined[i] = refined[0];
+	for (k = 0; k < cb->num_variables; k++) {
+		cb->variables[k*cb->n + i] = variables[cb->variable_index[k]];
+	}
+}
+
+int CountCellsSfcRange(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2,
+	int min_level, int max_level, int64_t *count
+) {
+	int ret, max_levels, num_levels, level;
+	int64_t sfc;
+	int *octs_per_level;
+
+	ret = artio_parameter_get_int(handle, "grid_max_level", &max_levels);
+	if (ret != ARTIO_SUCCESS) { return ret; }
+
+	octs_per_level = (int *) malloc((max_levels + 1) * sizeof(int));
+	if (octs_per_level == NULL) { return ARTIO_ERR_MEMORY_ALLOCATION; }
+
+	*count = 0;
+	ret = artio_grid_cache_sfc_range(handle, sfc1, sfc2);
+	for (sfc = sfc1; ret == ARTIO_SUCCESS && sfc <= sfc2; sfc++) {
+		ret = artio_grid_read_root_cell_begin(handle, sfc, NULL, NULL,
+			&num_levels, octs_per_level);
+		if (ret != ARTIO_SUCCESS) { break; }
+
+		if (min_level <= 0 && max_level >= 0) { *count += 1; }
+		for (level = 1; level <= num_levels; level++) {
+			if (level >= min_level && level <= max_level) {
+				*count += 8 * (int64_t) octs_per_level[level - 1];
+			}
+		}
+		ret = artio_grid_read_root_cell_end(handle);
+	}
+
+	free(octs_per_level);
+	return ret;
+}
+
+int GetCellsSfcRange(
+	artio_fileset *handle, int64_t sfc1, int64_t sfc2,
+	int min_level, int max_level, int options,
+	double *pos, int *level, int *refined,
+	int num_variables, int *variable_index, float *variables,
+	int64_t n, int64_t *num_cells
+) {
+	int ret;
+	CellBuffer cb;
+
+	cb.pos = pos;
+	cb.level = level;
+	cb.refined = refined;
+	cb.num_variables = num_variables;
+	cb.variable_index = variable_index;
+	cb.variables = variables;
+	cb.n = n;
+	cb.i = 0;
+
+	ret = artio_grid_read_sfc_range_levels(handle, sfc1, sfc2,
+		min_level, max_level, options | ARTIO_RETURN_CELLS,
+		GetCellsCallback, &cb);
+	*num_cells = cb.i;
+	if (ret == ARTIO_SUCCESS && cb.i > cb.n) {
+		ret = ARTIO_ERR_INVALID_SFC_RANGE;
+	}
+	return ret;
+}
+
+#endif /* ARTIO_CGO */
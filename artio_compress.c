@@ -0,0 +1,324 @@
+/**********************************************************************
+ * Copyright (c) 2012-2013, Douglas H. Rudd
+ * All rights reserved.
+ *
+ * This file is part of the artio library.
+ *
+ * artio is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * artio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * Copies of the GNU Lesser General Public License and the GNU General
+ * Public License are available in the file LICENSE, included with this
+ * distribution.  If you failed to receive a copy of this file, see
+ * <http://www.gnu.org/licenses/>
+ **********************************************************************/
+
+#include "artio.h"
+#include "artio_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Lossless codecs for compressed grid data.  Float variables are passed
+ * through a predictor which XORs each value with the one preceding it
+ * and splits the residuals into byte planes, so the slowly varying sign
+ * and exponent bytes form long runs.  The result is packed by a small
+ * LZ77 coder (the LZ4 block layout: a token of literal and match lengths,
+ * literals, then a 16-bit little-endian match offset).  Both stages are
+ * defined on bytes and so are independent of host byte order.
+ */
+
+#define ARTIO_LZ_HASH_BITS      14
+#define ARTIO_LZ_MIN_MATCH      4
+#define ARTIO_LZ_MAX_OFFSET     65535
+/* matches may not start in the final bytes of the input */
+#define ARTIO_LZ_TAIL           12
+
+static uint32_t artio_lz_read32( const unsigned char *p ) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static unsigned char *artio_lz_put_length( unsigned char *op, int64_t length ) {
+	while ( length >= 255 ) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (unsigned char)length;
+	return op;
+}
+
+int64_t artio_lz_bound( int64_t size ) {
+	return size + size/255 + 16;
+}
+
+/*
+ * Compress size bytes of src into dest, which must hold at least
+ * artio_lz_bound(size) bytes.  Returns the compressed size, or -1 if
+ * memory could not be allocated.
+ */
+int64_t artio_lz_compress( const unsigned char *src, int64_t size,
+		unsigned char *dest ) {
+	int i;
+	int64_t ip, anchor, ref, length, literals;
+	uint32_t sequence;
+	unsigned char *op, *token;
+	int64_t *table;
+
+	table = (int64_t *)malloc( (1<<ARTIO_LZ_HASH_BITS)*sizeof(int64_t) );
+	if ( table == NULL ) {
+		return -1;
+	}
+	for ( i = 0; i < (1<<ARTIO_LZ_HASH_BITS); i++ ) {
+		table[i] = -1;
+	}
+
+	op = dest;
+	ip = 0;
+	anchor = 0;
+	while ( ip < size - ARTIO_LZ_TAIL ) {
+		sequence = artio_lz_read32( src + ip );
+		i = (int)( (sequence * 2654435761u) >> (32 - ARTIO_LZ_HASH_BITS) );
+		ref = table[i];
+		table[i] = ip;
+
+		if ( ref < 0 || ip - ref > ARTIO_LZ_MAX_OFFSET ||
+				artio_lz_read32( src + ref ) != sequence ) {
+			ip++;
+			continue;
+		}
+
+		length = ARTIO_LZ_MIN_MATCH;
+		while ( ip + length < size - 5 && src[ref+length] == src[ip+length] ) {
+			length++;
+		}
+
+		literals = ip - anchor;
+		token = op++;
+		*token = (unsigned char)( MIN( literals, 15 ) << 4 );
+		if ( literals >= 15 ) {
+			op = artio_lz_put_length( op, literals - 15 );
+		}
+		memcpy( op, src + anchor, literals );
+		op += literals;
+
+		*op++ = (unsigned char)( (ip - ref) & 0xff );
+		*op++ = (unsigned char)( (ip - ref) >> 8 );
+
+		length -= ARTIO_LZ_MIN_MATCH;
+		*token |= (unsigned char)MIN( length, 15 );
+		if ( length >= 15 ) {
+			op = artio_lz_put_length( op, length - 15 );
+		}
+
+		ip += length + ARTIO_LZ_MIN_MATCH;
+		anchor = ip;
+	}
+
+	/* trailing literals, with no match following */
+	literals = size - anchor;
+	token = op++;
+	*token = (unsigned char)( MIN( literals, 15 ) << 4 );
+	if ( literals >= 15 ) {
+		op = artio_lz_put_length( op, literals - 15 );
+	}
+	memcpy( op, src + anchor, literals );
+	op += literals;
+
+	free( table );
+	return (int64_t)(op - dest);
+}
+
+/*
+ * Expand size bytes of src into exactly dest_size bytes of dest.
+ * Returns ARTIO_ERR_INVALID_COMPRESSION if the input is malformed.
+ */
+int artio_lz_decompress( const unsigned char *src, int64_t size,
+		unsigned char *dest, int64_t dest_size ) {
+	int64_t ip, op, length, offset;
+	unsigned char token, b;
+
+	ip = 0;
+	op = 0;
+	while ( ip < size ) {
+		token = src[ip++];
+
+		length = token >> 4;
+		if ( length == 15 ) {
+			do {
+				if ( ip >= size ) return ARTIO_ERR_INVALID_COMPRESSION;
+				b = src[ip++];
+				length += b;
+			} while ( b == 255 );
+		}
+
+		if ( length > size - ip || length > dest_size - op ) {
+			return ARTIO_ERR_INVALID_COMPRESSION;
+		}
+		memcpy( dest + op, src + ip, length );
+		ip += length;
+		op += length;
+
+		if ( ip == size ) break;
+
+		if ( ip + 2 > size ) return ARTIO_ERR_INVALID_COMPRESSION;
+		offset = (int64_t)src[ip] | ((int64_t)src[ip+1] << 8);
+		ip += 2;
+		if ( offset == 0 || offset > op ) {
+			return ARTIO_ERR_INVALID_COMPRESSION;
+		}
+
+		length = token & 15;
+		if ( length == 15 ) {
+			do {
+				if ( ip >= size ) return ARTIO_ERR_INVALID_COMPRESSION;
+				b = src[ip++];
+				length += b;
+			} while ( b == 255 );
+		}
+		length += ARTIO_LZ_MIN_MATCH;
+
+		if ( length > dest_size - op ) {
+			return ARTIO_ERR_INVALID_COMPRESSION;
+		}
+
+		if ( offset >= length ) {
+			memcpy( dest + op, dest + op - offset, length );
+			op += length;
+		} else {
+			/* overlapping match repeats the last offset bytes */
+			while ( length-- > 0 ) {
+				dest[op] = dest[op - offset];
+				op++;
+			}
+		}
+	}
+
+	return ( op == dest_size ) ? ARTIO_SUCCESS : ARTIO_ERR_INVALID_COMPRESSION;
+}
+
+/*
+ * Predict count floats taken every stride values from values, writing
+ * the XOR residuals as four byte planes of count bytes each, least
+ * significant byte first.
+ */
+void artio_float_planes_encode( const float *values, int64_t count, int stride,
+		unsigned char *planes ) {
+	int64_t i;
+	uint32_t bits, prev, residual;
+
+	prev = 0;
+	for ( i = 0; i < count; i++ ) {
+		memcpy( &bits, &values[i*stride], sizeof(uint32_t) );
+		residual = bits ^ prev;
+		prev = bits;
+
+		planes[i] = (unsigned char)( residual & 0xff );
+		planes[count+i] = (unsigned char)( (residual >> 8) & 0xff );
+		planes[2*count+i] = (unsigned char)( (residual >> 16) & 0xff );
+		planes[3*count+i] = (unsigned char)( residual >> 24 );
+	}
+}
+
+void artio_float_planes_decode( const unsigned char *planes, int64_t count,
+		int stride, float *values ) {
+	int64_t i;
+	uint32_t bits;
+
+	bits = 0;
+	for ( i = 0; i < count; i++ ) {
+		bits ^= (uint32_t)planes[i] |
+			((uint32_t)planes[count+i] << 8) |
+			((uint32_t)planes[2*count+i] << 16) |
+			((uint32_t)planes[3*count+i] << 24);
+		memcpy( &values[i*stride], &bits, sizeof(uint32_t) );
+	}
+}
+
+/*
+ * Conversion between float and IEEE 754 half precision, used for reduced
+ * particle variable storage.  Values are rounded to nearest even; those
+ * beyond the half range become infinite and NaNs stay NaN.
+ */
+uint16_t artio_float_to_half( float value ) {
+	uint32_t bits, mant, rem, half;
+	uint16_t sign, h;
+	int exponent, shift;
+
+	memcpy( &bits, &value, sizeof(uint32_t) );
+	sign = (uint16_t)( (bits >> 16) & 0x8000 );
+	exponent = (int)( (bits >> 23) & 0xff );
+	mant = bits & 0x7fffff;
+
+	if ( exponent == 0xff ) {
+		return sign | 0x7c00 | ( mant ? (uint16_t)( 0x200 | (mant >> 13) ) : 0 );
+	}
+
+	exponent = exponent - 127 + 15;
+	if ( exponent >= 0x1f ) {
+		return sign | 0x7c00;
+	}
+
+	if ( exponent <= 0 ) {
+		/* subnormal half, or zero */
+		if ( exponent < -10 ) {
+			return sign;
+		}
+		mant |= 0x800000;
+		shift = 14 - exponent;
+		h = (uint16_t)( mant >> shift );
+		rem = mant & ( (1u << shift) - 1 );
+		half = 1u << (shift - 1);
+	} else {
+		h = (uint16_t)( (exponent << 10) | (mant >> 13) );
+		rem = mant & 0x1fff;
+		half = 0x1000;
+	}
+
+	/* a carry out of the mantissa correctly increments the exponent */
+	if ( rem > half || ( rem == half && (h & 1) ) ) {
+		h++;
+	}
+	return sign | h;
+}
+
+float artio_half_to_float( uint16_t h ) {
+	uint32_t bits, sign, mant;
+	int exponent;
+	float value;
+
+	sign = (uint32_t)(h & 0x8000) << 16;
+	exponent = (h >> 10) & 0x1f;
+	mant = h & 0x3ff;
+
+	if ( exponent == 0 ) {
+		if ( mant == 0 ) {
+			bits = sign;
+		} else {
+			/* renormalize a subnormal */
+			exponent = 1;
+			while ( !(mant & 0x400) ) {
+				mant <<= 1;
+				exponent--;
+			}
+			mant &= 0x3ff;
+			bits = sign | ((uint32_t)(exponent + 112) << 23) | (mant << 13);
+		}
+	} else if ( exponent == 0x1f ) {
+		bits = sign | 0x7f800000 | (mant << 13);
+	} else {
+		bits = sign | ((uint32_t)(exponent + 112) << 23) | (mant << 13);
+	}
+
+	memcpy( &value, &bits, sizeof(float) );
+	return value;
+}
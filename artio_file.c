@@ -97,6 +97,21 @@ int artio_file_fflush(artio_fh *handle) {
 	return status;
 }
 
+int artio_file_fcopy(artio_fh *dest, artio_fh *src, int64_t count ) {
+	int status;
+#ifdef ARTIO_DEBUG
+	printf( "artio_file_fcopy( dest=%p, src=%p, count=%ld )\n",
+			dest, src, count ); fflush(stdout);
+#endif /* ARTIO_DEBUG */
+	status = artio_file_fcopy_i(dest,src,count);
+#ifdef ARTIO_DEBUG
+	if ( status != ARTIO_SUCCESS ) {
+		printf( "artio_file_fcopy(%p,%p) = %d\n", dest, src, status ); fflush(stdout);
+	}
+#endif /* ARTIO_DEBUG */
+	return status;
+}
+
 int artio_file_fread(artio_fh *handle, void *buf, int64_t count, int type ) {
 	int status;
 #ifdef ARTIO_DEBUG
@@ -27,11 +27,24 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <math.h>
+#include <string.h>
+
+#define ARTIO_GRID_COUNT_CHUNK	(1L<<16)
+#define ARTIO_GRID_BULK_CHUNK	(1L<<22)
 
 const char grid_file_suffix = 'g';
 
 artio_grid_file *artio_grid_file_allocate(void);
 void artio_grid_file_destroy(artio_grid_file *ghandle);
+int artio_grid_write_oct_counts( artio_fileset *handle );
+int artio_grid_read_oct_counts( artio_fileset *handle, int file,
+		int64_t start, int64_t end, int64_t *num_octs_per_sfc );
+int artio_grid_refined_size( artio_fileset *handle );
+int artio_grid_write_offset_tables( artio_fileset *handle );
+int artio_grid_tree_reserve( artio_grid_file *ghandle,
+		int num_oct_levels, int *num_octs_per_level );
+int artio_grid_write_tree( artio_fileset *handle );
+int artio_grid_read_tree( artio_fileset *handle );
 
 const double oct_pos_offsets[8][3] = {
 	{ -0.5, -0.5, -0.5 }, {  0.5, -0.5, -0.5 },
@@ -47,7 +60,7 @@ int artio_fileset_open_grid(artio_fileset *handle) {
 	int i;
 	char filename[512];
 	int first_file, last_file;
-	int mode;
+	int mode, oct_counts;
 	artio_grid_file *ghandle;
 
 	if ( handle == NULL ) {
@@ -75,6 +88,18 @@ int artio_fileset_open_grid(artio_fileset *handle) {
 		return ARTIO_ERR_GRID_DATA_NOT_FOUND;
 	}
 
+	if ( artio_parameter_get_int( handle, "grid_compression",
+			&ghandle->compression ) != ARTIO_SUCCESS ) {
+		ghandle->compression = ARTIO_GRID_COMPRESSION_NONE;
+	}
+
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE &&
+			ghandle->compression != ARTIO_GRID_COMPRESSION_LZ ) {
+		artio_grid_file_destroy(ghandle);
+		return ARTIO_ERR_INVALID_COMPRESSION;
+	}
+	ghandle->refined_size = artio_grid_refined_size( handle );
+
 	ghandle->file_sfc_index = (int64_t *)malloc(sizeof(int64_t) * (ghandle->num_grid_files + 1));
 	if ( ghandle->file_sfc_index == NULL ) {
 		artio_grid_file_destroy(ghandle);
@@ -140,6 +165,18 @@ int artio_fileset_open_grid(artio_fileset *handle) {
 		}
 	}
 
+	/* without the oct counts file, octs are counted from the grid files */
+	if ( artio_parameter_get_int(handle, "grid_oct_counts",
+			&oct_counts) == ARTIO_SUCCESS && oct_counts ) {
+		sprintf(filename, "%s.%coct", handle->file_prefix, grid_file_suffix);
+
+		mode = ARTIO_MODE_READ | ARTIO_MODE_ACCESS;
+		if (handle->endian_swap) {
+			mode |= ARTIO_MODE_ENDIAN_SWAP;
+		}
+		ghandle->oct_count_fh = artio_file_fopen(filename, mode, handle->context);
+	}
+
 	handle->grid = ghandle;
 	return ARTIO_SUCCESS;
 }
@@ -149,6 +186,7 @@ int artio_fileset_add_grid(artio_fileset *handle,
 		int num_grid_variables,
 		char ** grid_variable_labels ) {
 	int64_t count;
+	int compression, packed_refined, major;
 	artio_grid_file *ghandle;
 
 	if ( handle == NULL ) {
@@ -162,6 +200,36 @@ int artio_fileset_add_grid(artio_fileset *handle,
 	if ( handle->open_type & ARTIO_OPEN_GRID) {
 		return ARTIO_ERR_DATA_EXISTS;
 	}
+
+	if ( artio_parameter_get_int(handle, "grid_compression",
+			&compression) != ARTIO_SUCCESS ) {
+		compression = ARTIO_GRID_COMPRESSION_NONE;
+	}
+
+	if ( compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		if ( compression != ARTIO_GRID_COMPRESSION_LZ ) {
+			return ARTIO_ERR_INVALID_COMPRESSION;
+		}
+#ifdef ARTIO_MPI
+		/* record offsets are only known once written, and are filled into
+		 * the offset tables on close by the single writer of each file */
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+#endif /* ARTIO_MPI */
+
+	}
+
+	if ( artio_parameter_get_int(handle, "grid_packed_refined",
+			&packed_refined) != ARTIO_SUCCESS ) {
+		packed_refined = 0;
+	}
+
+	if ( compression != ARTIO_GRID_COMPRESSION_NONE || packed_refined ) {
+		/* older readers check only the major version */
+		major = ARTIO_COMPRESSED_MAJOR_VERSION;
+		artio_parameter_list_replace(handle->parameters, "ARTIO_MAJOR_VERSION",
+				1, &major, ARTIO_TYPE_INT);
+		handle->major_version = major;
+	}
 	handle->open_type |= ARTIO_OPEN_GRID;
 
 	artio_parameter_set_int(handle, "num_grid_files", num_grid_files);
@@ -177,12 +245,16 @@ int artio_fileset_add_grid(artio_fileset *handle,
 	ghandle->num_grid_files = num_grid_files;
 	ghandle->allocation_strategy = allocation_strategy;
 	ghandle->num_grid_variables = num_grid_variables;
+	ghandle->compression = compression;
+	ghandle->refined_size = artio_grid_refined_size( handle );
 
 	/* allocate space for root tree sizes and lists */
 	ghandle->sfc_size = (int64_t *)malloc(handle->num_local_root_cells*sizeof(int64_t));
 	ghandle->sfc_list = (int64_t *)malloc(handle->num_local_root_cells*sizeof(int64_t));
+	ghandle->sfc_num_octs = (int64_t *)malloc(handle->num_local_root_cells*sizeof(int64_t));
 	if ( ghandle->sfc_size == NULL ||
-			ghandle->sfc_list == NULL ) {
+			ghandle->sfc_list == NULL ||
+			ghandle->sfc_num_octs == NULL ) {
 		artio_grid_file_destroy(ghandle);
 		return ARTIO_ERR_MEMORY_ALLOCATION;
 	}
@@ -228,20 +300,24 @@ int artio_fileset_add_grid_sfc( artio_fileset *handle, int64_t sfc,
 		return ARTIO_ERR_INVALID_STATE;
 	}
 
-	/* compute space needed for this root tree */
+	/* compute space needed for this root tree; when compressed this is
+	 * only an estimate, used to apportion root cells to files */
 	size = sizeof(float) * ghandle->num_grid_variables +
 		sizeof(int) * (1 + root_tree_num_levels) +
-		8*root_tree_num_octs *
-		(sizeof(float)*ghandle->num_grid_variables + sizeof(int));
+		(int64_t)root_tree_num_octs *
+		(8*sizeof(float)*ghandle->num_grid_variables + ghandle->refined_size);
 
 	ghandle->sfc_list[ghandle->sfc_count] = sfc;
 	ghandle->sfc_size[ghandle->sfc_count] = size;
+	ghandle->sfc_num_octs[ghandle->sfc_count] = root_tree_num_octs;
 	ghandle->sfc_count++;
 
 	return ARTIO_SUCCESS;
 }
 
 int artio_fileset_commit_grid( artio_fileset *handle ) {
+	int i;
+	int64_t il;
 	artio_grid_file *ghandle;
 	int file_max_level, local_max_level;
 	int ret;
@@ -269,10 +345,15 @@ int artio_fileset_commit_grid( artio_fileset *handle ) {
 	}
 
 	ghandle->octs_per_level = (int *)malloc(ghandle->file_max_level * sizeof(int));
-	if ( ghandle->octs_per_level == NULL ) {
+	ghandle->num_octs_per_level = (int64_t *)malloc(ghandle->file_max_level * sizeof(int64_t));
+	if ( ghandle->octs_per_level == NULL || ghandle->num_octs_per_level == NULL ) {
 		artio_grid_file_destroy(ghandle);
 		return ARTIO_ERR_MEMORY_ALLOCATION;
 	}
+	for ( i = 0; i < ghandle->file_max_level; i++ ) {
+		ghandle->num_octs_per_level[i] = 0;
+	}
+	ghandle->num_octs_per_level_known = 1;
 	artio_parameter_set_int(handle, "grid_max_level", ghandle->file_max_level);
 
 	/* check that root tree counts equals num_local_cells */
@@ -281,6 +362,16 @@ int artio_fileset_commit_grid( artio_fileset *handle ) {
 		return ARTIO_ERR_INVALID_STATE;
 	}
 
+	/* compressed root trees are appended to their file in sfc order */
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		for ( il = 1; il < ghandle->sfc_count; il++ ) {
+			if ( ghandle->sfc_list[il] <= ghandle->sfc_list[il-1] ) {
+				artio_grid_file_destroy(ghandle);
+				return ARTIO_ERR_INVALID_STATE;
+			}
+		}
+	}
+
 	ghandle->file_sfc_index = (int64_t*)malloc( (ghandle->num_grid_files+1)*sizeof(int64_t) );
 	ghandle->ffh = (artio_fh **)malloc(ghandle->num_grid_files * sizeof(artio_fh *));
 	if ( ghandle->file_sfc_index == NULL || ghandle->ffh == NULL ) {
@@ -296,7 +387,9 @@ int artio_fileset_commit_grid( artio_fileset *handle ) {
 		ghandle->allocation_strategy,
 		grid_file_suffix,
 		ghandle->file_sfc_index,
-		ghandle->ffh );
+		ghandle->ffh,
+		&ghandle->num_sfc_tails,
+		&ghandle->sfc_tail );
 
 	if ( ret != ARTIO_SUCCESS ) {
 		artio_grid_file_destroy(ghandle);
@@ -322,10 +415,27 @@ artio_grid_file *artio_grid_file_allocate(void) {
 		ghandle->cache_sfc_begin = -1;
 		ghandle->cache_sfc_end = -1;
 		ghandle->sfc_offset_table = NULL;
+		ghandle->sfc_num_octs = NULL;
+		ghandle->oct_count_fh = NULL;
+		ghandle->num_octs_per_level = NULL;
+		ghandle->num_octs_per_level_known = 0;
+
+		ghandle->refined_size = 8*sizeof(int);
+		ghandle->compression = ARTIO_GRID_COMPRESSION_NONE;
+		ghandle->tree_decoded = 0;
+		ghandle->tree_packed_size = 0;
+		ghandle->tree_variables = NULL;
+		ghandle->tree_refined = NULL;
+		ghandle->tree_stream = NULL;
+		ghandle->tree_size = 0;
+		ghandle->tree_stream_size = 0;
+		ghandle->tree_level_oct = NULL;
 
 		ghandle->sfc_size = NULL;
 		ghandle->sfc_list = NULL;
 		ghandle->sfc_count = -1;
+		ghandle->num_sfc_tails = 0;
+		ghandle->sfc_tail = NULL;
 
 		ghandle->file_max_level = -1;
 		ghandle->cur_file = -1;
@@ -369,18 +479,30 @@ void artio_grid_file_destroy(artio_grid_file *ghandle) {
 
 	if ( ghandle->sfc_size != NULL ) free( ghandle->sfc_size );
 	if ( ghandle->sfc_list != NULL ) free( ghandle->sfc_list );
+	if ( ghandle->sfc_tail != NULL ) free( ghandle->sfc_tail );
+
+	if ( ghandle->sfc_num_octs != NULL ) free( ghandle->sfc_num_octs );
+	if ( ghandle->oct_count_fh != NULL ) artio_file_fclose( ghandle->oct_count_fh );
 
 	if ( ghandle->sfc_offset_table != NULL ) free(ghandle->sfc_offset_table);
+	if ( ghandle->num_octs_per_level != NULL ) free(ghandle->num_octs_per_level);
 	if ( ghandle->octs_per_level != NULL ) free(ghandle->octs_per_level);
 	if ( ghandle->file_sfc_index != NULL ) free(ghandle->file_sfc_index);
 	if ( ghandle->next_level_pos != NULL ) free(ghandle->next_level_pos);
 	if ( ghandle->cur_level_pos != NULL ) free(ghandle->cur_level_pos);
 	if ( ghandle->buffer != NULL ) free( ghandle->buffer );
+	if ( ghandle->tree_variables != NULL ) free( ghandle->tree_variables );
+	if ( ghandle->tree_refined != NULL ) free( ghandle->tree_refined );
+	if ( ghandle->tree_stream != NULL ) free( ghandle->tree_stream );
+	if ( ghandle->tree_level_oct != NULL ) free( ghandle->tree_level_oct );
 
 	free(ghandle);
 }
 
 int artio_fileset_close_grid(artio_fileset *handle) {
+	int ret = ARTIO_SUCCESS;
+	artio_grid_file *ghandle;
+
 	if ( handle == NULL ) {
 		return ARTIO_ERR_INVALID_HANDLE;
 	}
@@ -390,11 +512,343 @@ int artio_fileset_close_grid(artio_fileset *handle) {
 		return ARTIO_ERR_INVALID_FILESET_MODE;
 	}
 
+	ghandle = handle->grid;
+
+	/* record per-level oct totals so readers need not scan root trees */
+	if ( handle->open_mode == ARTIO_FILESET_WRITE &&
+			ghandle->num_octs_per_level != NULL &&
+			ghandle->file_max_level > 0 ) {
+#ifdef ARTIO_MPI
+		MPI_Allreduce( MPI_IN_PLACE, &ghandle->num_octs_per_level_known, 1,
+			MPI_INT, MPI_MIN, handle->context->comm );
+		MPI_Allreduce( MPI_IN_PLACE, ghandle->num_octs_per_level,
+			ghandle->file_max_level, MPI_INT64_T, MPI_SUM,
+			handle->context->comm );
+#endif /* ARTIO_MPI */
+		if ( ghandle->num_octs_per_level_known ) {
+			artio_parameter_set_long_array(handle, "grid_num_octs_per_level",
+					ghandle->file_max_level, ghandle->num_octs_per_level);
+		}
+	}
+
+	if ( handle->open_mode == ARTIO_FILESET_WRITE &&
+			ghandle->compression != ARTIO_GRID_COMPRESSION_NONE &&
+			ghandle->ffh != NULL ) {
+		ret = artio_grid_write_offset_tables( handle );
+	}
+
+#if !defined(ARTIO_MPI) || !defined(ARTIO_POSIX)
+	/* ranks writing through ARTIO_POSIX share no files */
+	if ( handle->open_mode == ARTIO_FILESET_WRITE &&
+			ghandle->ffh != NULL && ret == ARTIO_SUCCESS ) {
+		ret = artio_grid_write_oct_counts( handle );
+	}
+#endif
+
 	artio_grid_file_destroy(handle->grid);
 	handle->grid = NULL;
+	return ret;
+}
+
+/*
+ * Compressed root trees have sizes known only once written, so the
+ * offset tables written at commit hold estimates.  Overwrite them with
+ * the offsets recorded as each tree was appended.
+ */
+int artio_grid_write_offset_tables( artio_fileset *handle ) {
+	int ret;
+	int file;
+	int64_t il, next;
+	artio_grid_file *ghandle = handle->grid;
+
+	if ( ghandle->cur_file != -1 ) {
+		ret = artio_file_detach_buffer( ghandle->ffh[ghandle->cur_file] );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+		ghandle->cur_file = -1;
+	}
+
+	for ( il = 0; il < ghandle->sfc_count; il = next ) {
+		file = artio_find_file( ghandle->file_sfc_index,
+				ghandle->num_grid_files, ghandle->sfc_list[il] );
+
+		/* runs of consecutive sfc in one file are contiguous in its table */
+		next = il + 1;
+		while ( next < ghandle->sfc_count &&
+				ghandle->sfc_list[next] == ghandle->sfc_list[il] + (next - il) &&
+				ghandle->sfc_list[next] < ghandle->file_sfc_index[file+1] ) {
+			next++;
+		}
+
+		ret = artio_file_fseek( ghandle->ffh[file],
+				(ghandle->sfc_list[il] - ghandle->file_sfc_index[file])*sizeof(int64_t),
+				ARTIO_SEEK_SET );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		ret = artio_file_fwrite( ghandle->ffh[file], &ghandle->sfc_size[il],
+				next - il, ARTIO_TYPE_LONG );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
+
 	return ARTIO_SUCCESS;
 }
 
+/*
+ * Record the number of octs in each local root tree in <prefix>.goct, an
+ * int64 per root cell of the fileset in sfc order, so readers can count
+ * octs without reading the grid files.
+ */
+int artio_grid_write_oct_counts( artio_fileset *handle ) {
+	int ret = ARTIO_SUCCESS;
+	int mode;
+	int64_t il, next;
+	char filename[1024];
+	artio_fh *fh;
+	artio_grid_file *ghandle = handle->grid;
+
+	sprintf( filename, "%s.%coct", handle->file_prefix, grid_file_suffix );
+
+	mode = ARTIO_MODE_WRITE;
+	if ( handle->num_local_root_cells > 0 ) {
+		mode |= ARTIO_MODE_ACCESS;
+	}
+
+	fh = artio_file_fopen( filename, mode, handle->context );
+	if ( fh == NULL ) {
+		return ARTIO_ERR_FILE_CREATE;
+	}
+
+	for ( il = 0; il < handle->num_local_root_cells; il = next ) {
+		/* runs of consecutive sfc are contiguous in the file */
+		next = il + 1;
+		while ( next < handle->num_local_root_cells &&
+				ghandle->sfc_list[next] == ghandle->sfc_list[il] + (next - il) ) {
+			next++;
+		}
+
+		ret = artio_file_fseek( fh, ghandle->sfc_list[il]*sizeof(int64_t),
+				ARTIO_SEEK_SET );
+		if ( ret != ARTIO_SUCCESS ) break;
+
+		ret = artio_file_fwrite( fh, &ghandle->sfc_num_octs[il],
+				next - il, ARTIO_TYPE_LONG );
+		if ( ret != ARTIO_SUCCESS ) break;
+	}
+
+	artio_file_fclose( fh );
+
+	if ( ret == ARTIO_SUCCESS ) {
+		artio_parameter_set_int( handle, "grid_oct_counts", 1 );
+	}
+	return ret;
+}
+
+/*
+ * Split the root cells remaining to be written into num_writers handles
+ * which own disjoint sets of grid files, each with its own buffer, so
+ * they may be written from separate threads.  Writer k accepts the local
+ * root cells in [sfc_begin,sfc_end] (artio_fileset_get_sfc_range) in the
+ * order they were added.  The parent handle may not write until the
+ * writers are returned with artio_grid_join_writers.
+ */
+int artio_grid_fork_writers( artio_fileset *handle, int num_writers,
+		artio_fileset **writers ) {
+	int i, k;
+	int ret;
+	int first_file, last_file;
+	int64_t first, num_sfc;
+	int64_t *writer_index;
+	artio_grid_file *ghandle, *vhandle;
+	artio_fileset *view;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_WRITE ||
+			!(handle->open_type & ARTIO_OPEN_GRID) ||
+			handle->grid == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+#ifdef ARTIO_MPI
+	/* file handles are shared with the MPI layer, which is not assumed
+	 * to be thread-safe */
+	return ARTIO_ERR_INVALID_FILESET_MODE;
+#endif /* ARTIO_MPI */
+
+	ghandle = handle->grid;
+
+	if ( ghandle->sfc_list == NULL || ghandle->ffh == NULL ||
+			ghandle->cur_sfc != -1 || num_writers <= 0 ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	first = ghandle->sfc_count;
+	num_sfc = handle->num_local_root_cells - first;
+
+	writer_index = (int64_t *)malloc( (num_writers+1)*sizeof(int64_t) );
+	if ( writer_index == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	ret = artio_fileset_partition_writers( ghandle->sfc_list + first, num_sfc,
+			ghandle->file_sfc_index, ghandle->num_grid_files,
+			num_writers, writer_index );
+	if ( ret != ARTIO_SUCCESS ) {
+		free( writer_index );
+		return ret;
+	}
+
+	/* writers take over the file buffers */
+	if ( ghandle->cur_file != -1 ) {
+		ret = artio_file_detach_buffer( ghandle->ffh[ghandle->cur_file] );
+		ghandle->cur_file = -1;
+		if ( ret != ARTIO_SUCCESS ) {
+			free( writer_index );
+			return ret;
+		}
+	}
+
+	for ( k = 0; k < num_writers; k++ ) {
+		writers[k] = NULL;
+	}
+
+	for ( k = 0; k < num_writers; k++ ) {
+		view = artio_fileset_writer_view( handle );
+		if ( view == NULL ) break;
+		writers[k] = view;
+
+		vhandle = artio_grid_file_allocate();
+		if ( vhandle == NULL ) break;
+		view->grid = vhandle;
+		view->open_type |= ARTIO_OPEN_GRID;
+
+		vhandle->allocation_strategy = ghandle->allocation_strategy;
+		vhandle->num_grid_variables = ghandle->num_grid_variables;
+		vhandle->num_grid_files = ghandle->num_grid_files;
+		vhandle->file_sfc_index = ghandle->file_sfc_index;
+		vhandle->file_max_level = ghandle->file_max_level;
+		vhandle->compression = ghandle->compression;
+		vhandle->refined_size = ghandle->refined_size;
+		vhandle->sfc_list = ghandle->sfc_list + first + writer_index[k];
+		vhandle->sfc_size = ghandle->sfc_size + first + writer_index[k];
+		vhandle->sfc_num_octs = ghandle->sfc_num_octs + first + writer_index[k];
+		vhandle->num_sfc_tails = ghandle->num_sfc_tails;
+		vhandle->sfc_tail = ghandle->sfc_tail;
+		vhandle->sfc_count = 0;
+
+		view->num_local_root_cells = writer_index[k+1] - writer_index[k];
+		if ( view->num_local_root_cells > 0 ) {
+			view->proc_sfc_begin = vhandle->sfc_list[0];
+			view->proc_sfc_end = vhandle->sfc_list[view->num_local_root_cells-1];
+		}
+
+		vhandle->num_octs_per_level = (int64_t *)malloc(vhandle->file_max_level * sizeof(int64_t));
+		if ( vhandle->num_octs_per_level == NULL ) break;
+		for ( i = 0; i < vhandle->file_max_level; i++ ) {
+			vhandle->num_octs_per_level[i] = 0;
+		}
+		vhandle->num_octs_per_level_known = 1;
+
+		vhandle->octs_per_level = (int *)malloc(vhandle->file_max_level * sizeof(int));
+		vhandle->ffh = (artio_fh **)malloc(vhandle->num_grid_files * sizeof(artio_fh *));
+		if ( vhandle->octs_per_level == NULL || vhandle->ffh == NULL ) break;
+
+		/* each file is handed to exactly one writer */
+		for ( i = 0; i < vhandle->num_grid_files; i++ ) {
+			vhandle->ffh[i] = NULL;
+		}
+		if ( view->num_local_root_cells > 0 ) {
+			first_file = artio_find_file( vhandle->file_sfc_index,
+					vhandle->num_grid_files, view->proc_sfc_begin );
+			last_file = artio_find_file( vhandle->file_sfc_index,
+					vhandle->num_grid_files, view->proc_sfc_end );
+			for ( i = first_file; i <= last_file; i++ ) {
+				vhandle->ffh[i] = ghandle->ffh[i];
+			}
+		}
+	}
+
+	free( writer_index );
+
+	if ( k < num_writers ) {
+		artio_grid_join_writers( handle, num_writers, writers );
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	/* block writes through the parent until the writers are joined */
+	ghandle->sfc_count = handle->num_local_root_cells;
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Flush and release writers created by artio_grid_fork_writers, folding
+ * their oct counts back into the parent handle.  Returns
+ * ARTIO_ERR_INVALID_STATE if any writer did not write all of its root
+ * cells; the writers are released regardless.
+ */
+int artio_grid_join_writers( artio_fileset *handle, int num_writers,
+		artio_fileset **writers ) {
+	int i, k;
+	int ret, status;
+	artio_grid_file *ghandle, *vhandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_WRITE ||
+			!(handle->open_type & ARTIO_OPEN_GRID) ||
+			handle->grid == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	ghandle = handle->grid;
+	status = ARTIO_SUCCESS;
+
+	for ( k = 0; k < num_writers; k++ ) {
+		if ( writers[k] == NULL ) continue;
+		vhandle = writers[k]->grid;
+
+		if ( vhandle != NULL ) {
+			if ( vhandle->cur_file != -1 ) {
+				ret = artio_file_detach_buffer( vhandle->ffh[vhandle->cur_file] );
+				if ( ret != ARTIO_SUCCESS ) status = ret;
+			}
+
+			if ( vhandle->cur_sfc != -1 ||
+					vhandle->sfc_count != writers[k]->num_local_root_cells ) {
+				if ( status == ARTIO_SUCCESS ) status = ARTIO_ERR_INVALID_STATE;
+			}
+
+			if ( vhandle->num_octs_per_level != NULL ) {
+				for ( i = 0; i < ghandle->file_max_level; i++ ) {
+					ghandle->num_octs_per_level[i] += vhandle->num_octs_per_level[i];
+				}
+				ghandle->num_octs_per_level_known &= vhandle->num_octs_per_level_known;
+			}
+
+			/* release only what the writer owns */
+			if ( vhandle->ffh != NULL ) {
+				free( vhandle->ffh );
+				vhandle->ffh = NULL;
+			}
+			vhandle->file_sfc_index = NULL;
+			vhandle->sfc_list = NULL;
+			vhandle->sfc_size = NULL;
+			vhandle->sfc_num_octs = NULL;
+			vhandle->sfc_tail = NULL;
+			artio_grid_file_destroy( vhandle );
+		}
+
+		artio_fileset_free_view( writers[k] );
+		writers[k] = NULL;
+	}
+
+	return status;
+}
+
 int artio_grid_offset_position( artio_grid_file *ghandle, int file,
 		int64_t sfc, int64_t *offset ) {
 	int ret;
@@ -414,15 +868,133 @@ int artio_grid_offset_position( artio_grid_file *ghandle, int file,
 	return ARTIO_SUCCESS;
 }
 
-int artio_grid_octs_in_sfc_range(artio_fileset *handle,
+/*
+ * Bytes of refined flags stored with each oct: one when the fileset sets
+ * "grid_packed_refined", otherwise an int per cell.
+ */
+int artio_grid_refined_size( artio_fileset *handle ) {
+	int packed_refined;
+
+	if ( artio_parameter_get_int(handle, "grid_packed_refined",
+			&packed_refined) == ARTIO_SUCCESS && packed_refined ) {
+		return 1;
+	}
+	return 8*sizeof(int);
+}
+
+/*
+ * Number of octs in each root tree of [start,end], all in grid file file.
+ * Read from the oct counts file when the fileset has one.  Otherwise they
+ * are recovered from the differences of the offset table of the range,
+ * except when the number of levels in a root tree could alias an extra
+ * oct (8*num_variables <= max_level) or the grid is compressed, where the
+ * root tree headers of the range are read.
+ */
+int artio_grid_read_oct_counts( artio_fileset *handle, int file,
 		int64_t start, int64_t end, int64_t *num_octs_per_sfc ) {
 	int i;
 	int ret;
-	int file;
-	int64_t sfc;
-	int64_t offset, next_offset, size_offset;
+	int read_headers;
 	int num_oct_levels;
-	int *num_octs_per_level;
+	int64_t sfc, count, size;
+	int64_t *offsets;
+	artio_grid_file *ghandle = handle->grid;
+
+	count = end - start + 1;
+
+	if ( ghandle->oct_count_fh != NULL ) {
+		ret = artio_file_fseek( ghandle->oct_count_fh,
+				start*sizeof(int64_t), ARTIO_SEEK_SET );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		return artio_file_fread( ghandle->oct_count_fh, num_octs_per_sfc,
+				count, ARTIO_TYPE_LONG );
+	}
+
+	read_headers = ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ||
+			8*ghandle->num_grid_variables <= ghandle->file_max_level );
+
+	offsets = (int64_t *)malloc( (count+1)*sizeof(int64_t) );
+	if ( offsets == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	if ( ghandle->cur_file != -1 ) {
+		artio_file_detach_buffer( ghandle->ffh[ghandle->cur_file] );
+		ghandle->cur_file = -1;
+	}
+
+	artio_file_attach_buffer( ghandle->ffh[file],
+			ghandle->buffer, ghandle->buffer_size );
+
+	ret = artio_file_fseek( ghandle->ffh[file],
+			(start - ghandle->file_sfc_index[file])*sizeof(int64_t),
+			ARTIO_SEEK_SET );
+	if ( ret == ARTIO_SUCCESS ) {
+		if ( end + 1 < ghandle->file_sfc_index[file+1] ) {
+			ret = artio_file_fread( ghandle->ffh[file], offsets,
+					count+1, ARTIO_TYPE_LONG );
+		} else {
+			ret = artio_file_fread( ghandle->ffh[file], offsets,
+					count, ARTIO_TYPE_LONG );
+
+			/* last root cell in the file extends to the end of file */
+			if ( ret == ARTIO_SUCCESS && !read_headers ) {
+				ret = artio_file_fseek( ghandle->ffh[file], 0, ARTIO_SEEK_END );
+				if ( ret == ARTIO_SUCCESS ) {
+					ret = artio_file_ftell( ghandle->ffh[file], &offsets[count] );
+				}
+			}
+		}
+	}
+
+	for ( sfc = 0; sfc < count && ret == ARTIO_SUCCESS; sfc++ ) {
+		if ( read_headers ) {
+			ret = artio_file_fseek( ghandle->ffh[file],
+					offsets[sfc] + sizeof(float)*ghandle->num_grid_variables,
+					ARTIO_SEEK_SET );
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			ret = artio_file_fread( ghandle->ffh[file],
+					&num_oct_levels, 1, ARTIO_TYPE_INT );
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			if ( num_oct_levels < 0 || num_oct_levels > ghandle->file_max_level ) {
+				ret = ARTIO_ERR_INVALID_OCT_LEVELS;
+				break;
+			}
+
+			ret = artio_file_fread( ghandle->ffh[file], ghandle->octs_per_level,
+					num_oct_levels, ARTIO_TYPE_INT );
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			num_octs_per_sfc[sfc] = 0;
+			for ( i = 0; i < num_oct_levels; i++ ) {
+				num_octs_per_sfc[sfc] += ghandle->octs_per_level[i];
+			}
+		} else {
+			/* this assumes (num_levels_per_root_tree)*sizeof(int) <
+			 *   size of an oct, or 8*num_variables > max_level so the
+			 *   number of levels drops off in rounding to int
+			 */
+			size = offsets[sfc+1] - offsets[sfc];
+			num_octs_per_sfc[sfc] = ( size -
+					sizeof(float)*ghandle->num_grid_variables - sizeof(int) ) /
+				(8*sizeof(float)*ghandle->num_grid_variables + ghandle->refined_size);
+		}
+	}
+
+	artio_file_detach_buffer( ghandle->ffh[file] );
+	free( offsets );
+
+	return ret;
+}
+
+int artio_grid_octs_in_sfc_range(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *num_octs_per_sfc ) {
+	int ret;
+	int file;
+	int64_t first, last;
 	artio_grid_file *ghandle;
 
 	if ( handle == NULL ) {
@@ -447,83 +1019,167 @@ int artio_grid_octs_in_sfc_range(artio_fileset *handle,
 		return ARTIO_ERR_INVALID_STATE;
 	}
 
-	for ( i = 0; i < end-start+1; i++ ) {
-		num_octs_per_sfc[i] = 0;
-	}
+	file = artio_find_file(ghandle->file_sfc_index, ghandle->num_grid_files, start);
+	for ( first = start; first <= end; first = last + 1 ) {
+		while ( first >= ghandle->file_sfc_index[file+1] ) {
+			file++;
+		}
+		last = MIN( MIN( end, first + ARTIO_GRID_COUNT_CHUNK - 1 ),
+				ghandle->file_sfc_index[file+1] - 1 );
 
-	if ( 8*ghandle->num_grid_variables <= ghandle->file_max_level ) {
-		/* we can't compute the number of octs through the offset table */
-		ret = artio_grid_cache_sfc_range( handle, start, end );
+		ret = artio_grid_read_oct_counts( handle, file, first, last,
+				&num_octs_per_sfc[first - start] );
 		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
 
-		num_octs_per_level = (int *)malloc(ghandle->file_max_level*sizeof(int) );
-		if ( num_octs_per_level == NULL ) {
-			return ARTIO_ERR_MEMORY_ALLOCATION;
+	return ARTIO_SUCCESS;
+}
+
+int artio_grid_total_octs_in_sfc_range(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *num_octs_in_range ) {
+	int ret;
+	int file;
+	int64_t sfc, first, last;
+	int64_t *num_octs_per_sfc;
+	artio_grid_file *ghandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_READ ||
+			!(handle->open_type & ARTIO_OPEN_GRID) ||
+			handle->grid == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	if ( start > end || start < handle->proc_sfc_begin ||
+			end > handle->proc_sfc_end ) {
+		return ARTIO_ERR_INVALID_SFC_RANGE;
+	}
+
+	ghandle = handle->grid;
+
+	/* check that we're not in the middle of a read */
+	if ( ghandle->cur_sfc != -1 ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	num_octs_per_sfc = (int64_t *)malloc( MIN( end - start + 1,
+			ARTIO_GRID_COUNT_CHUNK ) * sizeof(int64_t) );
+	if ( num_octs_per_sfc == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	ret = ARTIO_SUCCESS;
+	*num_octs_in_range = 0;
+	file = artio_find_file(ghandle->file_sfc_index, ghandle->num_grid_files, start);
+	for ( first = start; first <= end; first = last + 1 ) {
+		while ( first >= ghandle->file_sfc_index[file+1] ) {
+			file++;
 		}
+		last = MIN( MIN( end, first + ARTIO_GRID_COUNT_CHUNK - 1 ),
+				ghandle->file_sfc_index[file+1] - 1 );
 
-		for ( sfc = start; sfc <= end; sfc++ ) {
-			ret = artio_grid_read_root_cell_begin( handle, sfc, NULL, NULL,
-					&num_oct_levels, num_octs_per_level );
-			if ( ret != ARTIO_SUCCESS ) return ret;
+		ret = artio_grid_read_oct_counts( handle, file, first, last,
+				num_octs_per_sfc );
+		if ( ret != ARTIO_SUCCESS ) break;
 
-			for ( i = 0; i < num_oct_levels; i++ ) {
-				num_octs_per_sfc[sfc-start] += num_octs_per_level[i];
-			}
+		for ( sfc = first; sfc <= last; sfc++ ) {
+			*num_octs_in_range += num_octs_per_sfc[sfc - first];
+		}
+	}
 
-			ret = artio_grid_read_root_cell_end( handle );
-			if ( ret != ARTIO_SUCCESS ) return ret;
+	free( num_octs_per_sfc );
+	return ret;
+}
+
+/*
+ * Total number of octs on each level of the fileset.  Taken from the
+ * header when present, otherwise computed (once) from the root tree
+ * headers.  num_octs_per_level must hold grid_max_level entries.
+ */
+int artio_grid_count_octs_per_level(artio_fileset *handle,
+		int64_t *num_octs_per_level ) {
+	int i;
+	int ret;
+	int64_t sfc;
+	int num_oct_levels;
+	artio_grid_file *ghandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_READ ||
+			!(handle->open_type & ARTIO_OPEN_GRID) ||
+			handle->grid == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	ghandle = handle->grid;
+
+	if ( ghandle->cur_sfc != -1 ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	if ( ghandle->num_octs_per_level == NULL ) {
+		ghandle->num_octs_per_level = (int64_t *)malloc(
+				ghandle->file_max_level*sizeof(int64_t) );
+		if ( ghandle->num_octs_per_level == NULL ) {
+			return ARTIO_ERR_MEMORY_ALLOCATION;
 		}
 
-		free( num_octs_per_level );
-	} else {
-		/* this version guarantees minimal memory use, but may require an additional
-		 * I/O sweep through the offset table */
-		file = artio_find_file(ghandle->file_sfc_index, ghandle->num_grid_files, start);
+		if ( artio_parameter_get_long_array( handle, "grid_num_octs_per_level",
+				ghandle->file_max_level, ghandle->num_octs_per_level ) != ARTIO_SUCCESS ) {
+			/* older filesets: sum over all root tree headers */
+			for ( i = 0; i < ghandle->file_max_level; i++ ) {
+				ghandle->num_octs_per_level[i] = 0;
+			}
 
-		ret = artio_grid_offset_position( ghandle, file, start, &offset );
-		if ( ret != ARTIO_SUCCESS ) return ret;
+			for ( sfc = handle->proc_sfc_begin; sfc <= handle->proc_sfc_end; sfc++ ) {
+				ret = ARTIO_SUCCESS;
+				if ( sfc > ghandle->cache_sfc_end || sfc < ghandle->cache_sfc_begin ) {
+					ret = artio_grid_cache_sfc_range( handle, sfc,
+							MIN( sfc + ARTIO_GRID_COUNT_CHUNK - 1, handle->proc_sfc_end ) );
+				}
+				if ( ret == ARTIO_SUCCESS ) {
+					ret = artio_grid_read_root_cell_begin( handle, sfc, NULL, NULL,
+						&num_oct_levels, ghandle->octs_per_level );
+				}
+				if ( ret == ARTIO_SUCCESS ) {
+					for ( i = 0; i < num_oct_levels; i++ ) {
+						ghandle->num_octs_per_level[i] += ghandle->octs_per_level[i];
+					}
+					ret = artio_grid_read_root_cell_end( handle );
+				}
 
-		for ( sfc = start; sfc <= end; sfc++ ) {
-			/* read next offset or compute end of file */
-			if ( sfc < ghandle->file_sfc_index[file+1] - 1 ) {
-				ret = artio_grid_offset_position( ghandle, file, sfc+1, &size_offset );
-				if ( ret != ARTIO_SUCCESS ) return ret;
-				next_offset = size_offset;
-			} else {
-				/* need to seek and ftell */
-				artio_file_fseek( ghandle->ffh[file], 0, ARTIO_SEEK_END );
-				artio_file_ftell( ghandle->ffh[file], &size_offset );
-				file++;
-
-				if ( sfc < end && file < ghandle->num_grid_files ) {
-					ret = artio_grid_offset_position( ghandle, file, sfc+1, &next_offset );
-					if ( ret != ARTIO_SUCCESS ) return ret;
+				if ( ret != ARTIO_SUCCESS ) {
+					free( ghandle->num_octs_per_level );
+					ghandle->num_octs_per_level = NULL;
+					return ret;
 				}
 			}
-
-			/* this assumes (num_levels_per_root_tree)*sizeof(int) <
-			 *   size of an oct, or 8*num_variables > max_level so the
-			 *   number of levels drops off in rounding to int
-			 */
-			num_octs_per_sfc[sfc-start] = (size_offset - offset -
-					sizeof(float)*ghandle->num_grid_variables - sizeof(int) ) /
-				(8*(sizeof(float)*ghandle->num_grid_variables + sizeof(int) ));
-			offset = next_offset;
 		}
 	}
 
+	for ( i = 0; i < ghandle->file_max_level; i++ ) {
+		num_octs_per_level[i] = ghandle->num_octs_per_level[i];
+	}
+
 	return ARTIO_SUCCESS;
 }
 
-int artio_grid_total_octs_in_sfc_range(artio_fileset *handle,
-		int64_t start, int64_t end, int64_t *num_octs_in_range ) {
-	int i;
+/*
+ * Compute the number of bytes stored on disk for each root cell in
+ * [start,end] from the differences of the grid file offset tables.
+ */
+int artio_grid_sfc_sizes(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *sfc_sizes ) {
 	int ret;
 	int file;
 	int64_t sfc;
-	int64_t offset, next_offset, size_offset;
-	int num_oct_levels;
-	int *num_octs_per_level;
+	int64_t offset, next_offset;
 	artio_grid_file *ghandle;
 
 	if ( handle == NULL ) {
@@ -548,64 +1204,44 @@ int artio_grid_total_octs_in_sfc_range(artio_fileset *handle,
 		return ARTIO_ERR_INVALID_STATE;
 	}
 
-	*num_octs_in_range = 0;
-
-	if ( 8*ghandle->num_grid_variables <= ghandle->file_max_level ) {
-		/* we can't compute the number of octs through the offset table */
-		ret = artio_grid_cache_sfc_range( handle, start, end );
-		if ( ret != ARTIO_SUCCESS ) return ret;
+	ret = artio_grid_cache_sfc_range( handle, start, end );
+	if ( ret != ARTIO_SUCCESS ) return ret;
 
-		num_octs_per_level = (int *)malloc(ghandle->file_max_level*sizeof(int) );
-		if ( num_octs_per_level == NULL ) {
-			return ARTIO_ERR_MEMORY_ALLOCATION;
-		}
+	file = artio_find_file(ghandle->file_sfc_index, ghandle->num_grid_files, start);
+	/* the cache may hold a larger range than requested */
+	offset = ghandle->sfc_offset_table[start - ghandle->cache_sfc_begin];
 
-		for ( sfc = start; sfc <= end; sfc++ ) {
-			ret = artio_grid_read_root_cell_begin( handle, sfc, NULL, NULL,
-					&num_oct_levels, num_octs_per_level );
-			if ( ret != ARTIO_SUCCESS ) return ret;
+	for ( sfc = start; sfc <= end; sfc++ ) {
+		if ( sfc < ghandle->file_sfc_index[file+1] - 1 ) {
+			if ( sfc < end ) {
+				next_offset = ghandle->sfc_offset_table[sfc + 1 - ghandle->cache_sfc_begin];
+			} else {
+				ret = artio_file_fseek( ghandle->ffh[file],
+						(sfc + 1 - ghandle->file_sfc_index[file])*sizeof(int64_t),
+						ARTIO_SEEK_SET );
+				if ( ret != ARTIO_SUCCESS ) return ret;
 
-			for ( i = 0; i < num_oct_levels; i++ ) {
-				*num_octs_in_range += num_octs_per_level[i];
+				ret = artio_file_fread( ghandle->ffh[file], &next_offset,
+						1, ARTIO_TYPE_LONG );
+				if ( ret != ARTIO_SUCCESS ) return ret;
 			}
+			sfc_sizes[sfc - start] = next_offset - offset;
+		} else {
+			/* last root cell in the file extends to the end of file */
+			ret = artio_file_fseek( ghandle->ffh[file], 0, ARTIO_SEEK_END );
+			if ( ret != ARTIO_SUCCESS ) return ret;
 
-			ret = artio_grid_read_root_cell_end( handle );
+			ret = artio_file_ftell( ghandle->ffh[file], &next_offset );
 			if ( ret != ARTIO_SUCCESS ) return ret;
-		}
 
-		free( num_octs_per_level );
-	} else {
-		file = artio_find_file(ghandle->file_sfc_index, ghandle->num_grid_files, start);
-		ret = artio_grid_offset_position( ghandle, file, start, &offset );
-		if ( ret != ARTIO_SUCCESS ) return ret;
+			sfc_sizes[sfc - start] = next_offset - offset;
+			file++;
 
-		for ( sfc = start; sfc <= end; sfc++ ) {
-			/* read next offset or compute end of file */
-			if ( sfc < ghandle->file_sfc_index[file+1] - 1 ) {
-				ret = artio_grid_offset_position( ghandle, file, sfc+1, &size_offset );
-				if ( ret != ARTIO_SUCCESS ) return ret;
-				next_offset = size_offset;
-			} else {
-				/* need to seek and ftell */
-				artio_file_fseek( ghandle->ffh[file], 0, ARTIO_SEEK_END );
-				artio_file_ftell( ghandle->ffh[file], &size_offset );
-				file++;
-
-				if ( sfc < end && file < ghandle->num_grid_files ) {
-					ret = artio_grid_offset_position( ghandle, file, sfc+1, &next_offset );
-					if ( ret != ARTIO_SUCCESS ) return ret;
-				}
+			if ( sfc < end ) {
+				next_offset = ghandle->sfc_offset_table[sfc + 1 - ghandle->cache_sfc_begin];
 			}
-
-			/* this assumes (num_levels_per_root_tree)*sizeof(int) <
-			 *   size of an oct, or 8*num_variables > max_level so the
-			 *   number of levels drops off in rounding to int
-			 */
-			*num_octs_in_range += (size_offset - offset -
-					sizeof(float)*ghandle->num_grid_variables - sizeof(int) ) /
-				(8*(sizeof(float)*ghandle->num_grid_variables + sizeof(int) ));
-			offset = next_offset;
 		}
+		offset = next_offset;
 	}
 
 	return ARTIO_SUCCESS;
@@ -762,6 +1398,135 @@ int artio_grid_seek_to_sfc(artio_fileset *handle, int64_t sfc) {
 			offset, ARTIO_SEEK_SET);
 }
 
+/*
+ * Copy the root cells [start,end] of src, open for reading, verbatim into
+ * dest, open for writing, without decoding them.  The root cells must be
+ * the next ones dest expects, declared with the same number of levels and
+ * octs as in src.  Records are copied in spans as large as the file layouts
+ * of both filesets allow, in the kernel where supported.  Replaces any
+ * cached sfc range of src.
+ */
+int artio_grid_copy_root_cells(artio_fileset *src, artio_fileset *dest,
+		int64_t start, int64_t end) {
+	int ret = ARTIO_SUCCESS;
+	int src_file, dest_file;
+	int64_t sfc, span_end;
+	int64_t chunk_start, chunk_end;
+	int64_t size;
+	int64_t *sfc_sizes;
+	artio_grid_file *sghandle, *dghandle;
+
+	if ( src == NULL || dest == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if ( src->open_mode != ARTIO_FILESET_READ ||
+			!(src->open_type & ARTIO_OPEN_GRID) ||
+			src->grid == NULL ||
+			dest->open_mode != ARTIO_FILESET_WRITE ||
+			!(dest->open_type & ARTIO_OPEN_GRID) ||
+			dest->grid == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	/* records are copied in the byte order they were written */
+	if ( src->endian_swap ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	if ( start > end || start < src->proc_sfc_begin ||
+			end > src->proc_sfc_end ) {
+		return ARTIO_ERR_INVALID_SFC_RANGE;
+	}
+
+	sghandle = src->grid;
+	dghandle = dest->grid;
+
+	if ( sghandle->cur_sfc != -1 || dghandle->cur_sfc != -1 ||
+			sghandle->num_grid_variables != dghandle->num_grid_variables ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	/* oct records must share a layout */
+	if ( sghandle->refined_size != dghandle->refined_size ) {
+		return ARTIO_ERR_VERSION_MISMATCH;
+	}
+
+	/* offsets in dest are laid out for uncompressed records */
+	if ( sghandle->compression != ARTIO_GRID_COMPRESSION_NONE ||
+			dghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		return ARTIO_ERR_INVALID_COMPRESSION;
+	}
+
+	sfc_sizes = (int64_t *)malloc( MIN( end - start + 1, ARTIO_GRID_COUNT_CHUNK ) *
+			sizeof(int64_t) );
+	if ( sfc_sizes == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	for ( chunk_start = start; chunk_start <= end;
+			chunk_start += ARTIO_GRID_COUNT_CHUNK ) {
+		chunk_end = MIN( chunk_start + ARTIO_GRID_COUNT_CHUNK - 1, end );
+
+		ret = artio_grid_sfc_sizes( src, chunk_start, chunk_end, sfc_sizes );
+		if ( ret != ARTIO_SUCCESS ) break;
+
+		sfc = chunk_start;
+		while ( sfc <= chunk_end ) {
+			ret = artio_grid_seek_to_sfc( dest, sfc );
+			if ( ret != ARTIO_SUCCESS ) break;
+			dest_file = dghandle->cur_file;
+
+			src_file = artio_find_file( sghandle->file_sfc_index,
+					sghandle->num_grid_files, sfc );
+			ret = artio_file_fseek( sghandle->ffh[src_file],
+					sghandle->sfc_offset_table[sfc - sghandle->cache_sfc_begin],
+					ARTIO_SEEK_SET );
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			/* extend the span while both layouts keep the records adjacent,
+			 * checking each record against the size declared in dest */
+			size = 0;
+			span_end = sfc;
+			for ( ;; ) {
+				if ( artio_sfc_declared_size( dghandle->sfc_list, dghandle->sfc_size,
+						dghandle->sfc_count-1, dghandle->num_sfc_tails,
+						dghandle->sfc_tail ) != sfc_sizes[span_end - chunk_start] ) {
+					/* declared root cell differs from the source */
+					ret = ARTIO_ERR_INVALID_STATE;
+					break;
+				}
+				size += sfc_sizes[span_end - chunk_start];
+
+				if ( span_end == chunk_end ||
+						span_end + 1 >= sghandle->file_sfc_index[src_file+1] ||
+						dghandle->sfc_count >= dest->num_local_root_cells ||
+						dghandle->sfc_list[dghandle->sfc_count] != span_end + 1 ||
+						span_end + 1 >= dghandle->file_sfc_index[dest_file+1] ) {
+					break;
+				}
+				dghandle->sfc_count++;
+				span_end++;
+			}
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			ret = artio_file_fcopy( dghandle->ffh[dest_file],
+					sghandle->ffh[src_file], size );
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			sfc = span_end + 1;
+		}
+		if ( ret != ARTIO_SUCCESS ) break;
+	}
+
+	free( sfc_sizes );
+
+	/* copied root trees are not decoded, so level totals are unknown */
+	dghandle->num_octs_per_level_known = 0;
+
+	return ret;
+}
+
 int artio_grid_write_root_cell_begin(artio_fileset *handle, int64_t sfc,
 		float *variables, int num_oct_levels, int *num_octs_per_level) {
 	int i;
@@ -799,8 +1564,18 @@ int artio_grid_write_root_cell_begin(artio_fileset *handle, int64_t sfc,
 			num_octs_per_level, num_oct_levels, ARTIO_TYPE_INT);
 	if ( ret != ARTIO_SUCCESS ) return ret;
 
+	/* seek_to_sfc has advanced sfc_count past this root cell */
+	ghandle->sfc_num_octs[ghandle->sfc_count-1] = 0;
 	for (i = 0; i < num_oct_levels; i++) {
 		ghandle->octs_per_level[i] = num_octs_per_level[i];
+		ghandle->num_octs_per_level[i] += num_octs_per_level[i];
+		ghandle->sfc_num_octs[ghandle->sfc_count-1] += num_octs_per_level[i];
+	}
+
+	/* compressed octs are staged until the root tree is complete */
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		ret = artio_grid_tree_reserve( ghandle, num_oct_levels, num_octs_per_level );
+		if ( ret != ARTIO_SUCCESS ) return ret;
 	}
 
 	ghandle->cur_sfc = sfc;
@@ -812,6 +1587,8 @@ int artio_grid_write_root_cell_begin(artio_fileset *handle, int64_t sfc,
 }
 
 int artio_grid_write_root_cell_end(artio_fileset *handle) {
+	int ret;
+
 	if ( handle == NULL ) {
 		return ARTIO_ERR_INVALID_HANDLE;
 	}
@@ -822,10 +1599,127 @@ int artio_grid_write_root_cell_end(artio_fileset *handle) {
 		return ARTIO_ERR_INVALID_FILESET_MODE;
 	}
 
+	if ( handle->grid->compression != ARTIO_GRID_COMPRESSION_NONE &&
+			handle->grid->cur_sfc != -1 ) {
+		ret = artio_grid_write_tree( handle );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
+
 	handle->grid->cur_sfc = -1;
 	return ARTIO_SUCCESS;
 }
 
+/*
+ * Size the staging buffers for a compressed root tree and index the
+ * first oct of each level within them.
+ */
+int artio_grid_tree_reserve( artio_grid_file *ghandle,
+		int num_oct_levels, int *num_octs_per_level ) {
+	int i;
+	int64_t num_octs;
+
+	if ( ghandle->tree_level_oct == NULL ) {
+		ghandle->tree_level_oct = (int64_t *)malloc( (ghandle->file_max_level+1)*sizeof(int64_t) );
+		if ( ghandle->tree_level_oct == NULL ) {
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+	}
+
+	num_octs = 0;
+	for ( i = 0; i < num_oct_levels; i++ ) {
+		ghandle->tree_level_oct[i] = num_octs;
+		num_octs += num_octs_per_level[i];
+	}
+	ghandle->tree_level_oct[num_oct_levels] = num_octs;
+
+	if ( num_octs > ghandle->tree_size ) {
+		if ( ghandle->tree_variables != NULL ) free( ghandle->tree_variables );
+		if ( ghandle->tree_refined != NULL ) free( ghandle->tree_refined );
+		ghandle->tree_variables = (float *)malloc( 8*num_octs*
+				ghandle->num_grid_variables*sizeof(float) );
+		ghandle->tree_refined = (unsigned char *)malloc( num_octs );
+		if ( ghandle->tree_variables == NULL || ghandle->tree_refined == NULL ) {
+			ghandle->tree_size = 0;
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+		ghandle->tree_size = num_octs;
+	}
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Stream a staged root tree, level by level, as the predicted byte planes
+ * of each variable followed by one refined mask byte per oct, and pack
+ * it behind the root tree header already written.  The next root cell of
+ * the file starts where this one ends.
+ */
+int artio_grid_write_tree( artio_fileset *handle ) {
+	int i, v;
+	int ret;
+	int64_t num_octs, stream_size, packed_size, record_size;
+	unsigned char *p, *packed;
+	artio_grid_file *ghandle = handle->grid;
+
+	stream_size = ghandle->tree_level_oct[ghandle->cur_num_levels]*
+		(8*ghandle->num_grid_variables*sizeof(float) + 1);
+
+	if ( stream_size + artio_lz_bound(stream_size) > ghandle->tree_stream_size ) {
+		if ( ghandle->tree_stream != NULL ) free( ghandle->tree_stream );
+		ghandle->tree_stream_size = stream_size + artio_lz_bound(stream_size);
+		ghandle->tree_stream = (unsigned char *)malloc( ghandle->tree_stream_size );
+		if ( ghandle->tree_stream == NULL ) {
+			ghandle->tree_stream_size = 0;
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+	}
+
+	p = ghandle->tree_stream;
+	for ( i = 0; i < ghandle->cur_num_levels; i++ ) {
+		num_octs = ghandle->octs_per_level[i];
+		for ( v = 0; v < ghandle->num_grid_variables; v++ ) {
+			artio_float_planes_encode( &ghandle->tree_variables[
+					8*ghandle->tree_level_oct[i]*ghandle->num_grid_variables + v],
+					8*num_octs, ghandle->num_grid_variables, p );
+			p += 8*num_octs*sizeof(float);
+		}
+		memcpy( p, &ghandle->tree_refined[ghandle->tree_level_oct[i]], num_octs );
+		p += num_octs;
+	}
+
+	packed = ghandle->tree_stream + stream_size;
+	if ( stream_size > 0 ) {
+		packed_size = artio_lz_compress( ghandle->tree_stream, stream_size, packed );
+		if ( packed_size < 0 ) {
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+	} else {
+		packed_size = 0;
+	}
+
+	ret = artio_file_fwrite(ghandle->ffh[ghandle->cur_file],
+			&packed_size, 1, ARTIO_TYPE_LONG);
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	ret = artio_file_fwrite(ghandle->ffh[ghandle->cur_file],
+			packed, packed_size, ARTIO_TYPE_CHAR);
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	record_size = sizeof(float)*ghandle->num_grid_variables +
+		sizeof(int)*(1 + ghandle->cur_num_levels) +
+		sizeof(int64_t) + packed_size;
+
+	/* seek_to_sfc has advanced sfc_count past this root cell */
+	if ( ghandle->sfc_count < handle->num_local_root_cells &&
+			ghandle->sfc_list[ghandle->sfc_count] <
+				ghandle->file_sfc_index[ghandle->cur_file+1] ) {
+		ghandle->sfc_size[ghandle->sfc_count] =
+			ghandle->sfc_size[ghandle->sfc_count-1] + record_size;
+	}
+
+	return ARTIO_SUCCESS;
+}
+
 int artio_grid_write_level_begin(artio_fileset *handle, int level) {
 	artio_grid_file *ghandle;
 
@@ -880,6 +1774,8 @@ int artio_grid_write_oct(artio_fileset *handle, float *variables,
 		int *cellrefined) {
 	int i;
 	int ret;
+	int64_t oct;
+	unsigned char mask;
 	artio_grid_file *ghandle;
 
 	if ( handle == NULL ) {
@@ -908,19 +1804,139 @@ int artio_grid_write_oct(artio_fileset *handle, float *variables,
 		}
 	}
 
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		oct = ghandle->tree_level_oct[ghandle->cur_level-1] + ghandle->cur_octs;
+		memcpy( &ghandle->tree_variables[8*oct*ghandle->num_grid_variables],
+				variables, 8*ghandle->num_grid_variables*sizeof(float) );
+		ghandle->tree_refined[oct] = 0;
+		for ( i = 0; i < 8; i++ ) {
+			if ( cellrefined[i] ) {
+				ghandle->tree_refined[oct] |= (1<<i);
+			}
+		}
+		ghandle->cur_octs++;
+		return ARTIO_SUCCESS;
+	}
+
 	ret = artio_file_fwrite(ghandle->ffh[ghandle->cur_file],
 			variables, 8 * ghandle->num_grid_variables,
 			ARTIO_TYPE_FLOAT);
 	if ( ret != ARTIO_SUCCESS ) return ret;
 
-	ret = artio_file_fwrite(ghandle->ffh[ghandle->cur_file],
-			cellrefined, 8, ARTIO_TYPE_INT);
+	if ( ghandle->refined_size == 1 ) {
+		mask = 0;
+		for ( i = 0; i < 8; i++ ) {
+			if ( cellrefined[i] ) {
+				mask |= (1<<i);
+			}
+		}
+		ret = artio_file_fwrite(ghandle->ffh[ghandle->cur_file],
+				&mask, 1, ARTIO_TYPE_CHAR);
+	} else {
+		ret = artio_file_fwrite(ghandle->ffh[ghandle->cur_file],
+				cellrefined, 8, ARTIO_TYPE_INT);
+	}
 	if ( ret != ARTIO_SUCCESS ) return ret;
 
 	ghandle->cur_octs++;
 	return ARTIO_SUCCESS;
 }
 
+int artio_grid_write_level_bulk(artio_fileset *handle, int level,
+		float *variables, int *cellrefined) {
+	int i, j;
+	int ret;
+	int64_t oct, num_octs, chunk_octs, count;
+	size_t var_size, oct_size;
+	unsigned char mask;
+	char *staging, *p;
+	artio_grid_file *ghandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_WRITE ||
+			!(handle->open_type & ARTIO_OPEN_GRID) ||
+			handle->grid == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	ghandle = handle->grid;
+
+	if (ghandle->cur_sfc == -1 || ghandle->cur_level != -1 ||
+			level <= 0 || level > ghandle->cur_num_levels) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	num_octs = ghandle->octs_per_level[level - 1];
+
+	/* check that no last-level octs have refined cells */
+	if ( level == ghandle->cur_num_levels ) {
+		for ( i = 0; i < 8*num_octs; i++ ) {
+			if ( cellrefined[i] ) {
+				return ARTIO_ERR_INVALID_OCT_REFINED;
+			}
+		}
+	}
+
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		oct = ghandle->tree_level_oct[level-1];
+		memcpy( &ghandle->tree_variables[8*oct*ghandle->num_grid_variables],
+				variables, 8*num_octs*ghandle->num_grid_variables*sizeof(float) );
+		for ( count = 0; count < num_octs; count++ ) {
+			ghandle->tree_refined[oct+count] = 0;
+			for ( i = 0; i < 8; i++ ) {
+				if ( cellrefined[8*count+i] ) {
+					ghandle->tree_refined[oct+count] |= (1<<i);
+				}
+			}
+		}
+		return ARTIO_SUCCESS;
+	}
+
+	/* interleave variables and refined flags into the on-disk oct layout,
+	 * a chunk at a time */
+	var_size = 8*ghandle->num_grid_variables*sizeof(float);
+	oct_size = var_size + ghandle->refined_size;
+	chunk_octs = MAX( 1, MIN( num_octs, ARTIO_GRID_BULK_CHUNK / (int64_t)oct_size ) );
+
+	staging = (char *)malloc( chunk_octs*oct_size );
+	if ( staging == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	for ( oct = 0; oct < num_octs; oct += count ) {
+		count = MIN( chunk_octs, num_octs - oct );
+		p = staging;
+		for ( i = 0; i < count; i++ ) {
+			memcpy( p, &variables[(oct+i)*8*ghandle->num_grid_variables], var_size );
+			if ( ghandle->refined_size == 1 ) {
+				mask = 0;
+				for ( j = 0; j < 8; j++ ) {
+					if ( cellrefined[8*(oct+i)+j] ) {
+						mask |= (1<<j);
+					}
+				}
+				p[var_size] = (char)mask;
+			} else {
+				memcpy( p + var_size, &cellrefined[8*(oct+i)], 8*sizeof(int) );
+			}
+			p += oct_size;
+		}
+
+		ret = artio_file_fwrite(ghandle->ffh[ghandle->cur_file],
+				staging, count*oct_size, ARTIO_TYPE_CHAR);
+		if ( ret != ARTIO_SUCCESS ) {
+			free( staging );
+			return ret;
+		}
+	}
+
+	free( staging );
+	return ARTIO_SUCCESS;
+}
+
 /*
  *
  */
@@ -1006,7 +2022,14 @@ int artio_grid_read_root_cell_begin(artio_fileset *handle, int64_t sfc,
 		for (i = 0; i < *num_oct_levels; i++) {
 			ghandle->octs_per_level[i] = num_octs_per_level[i];
 		}
+
+		if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+			ret = artio_file_fread(ghandle->ffh[ghandle->cur_file],
+					&ghandle->tree_packed_size, 1, ARTIO_TYPE_LONG);
+			if ( ret != ARTIO_SUCCESS ) return ret;
+		}
 	}
+	ghandle->tree_decoded = 0;
 
 	ghandle->cur_sfc = sfc;
 	ghandle->cur_num_levels = *num_oct_levels;
@@ -1021,6 +2044,8 @@ int artio_grid_read_oct(artio_fileset *handle,
 		int *refined) {
 	int i, j;
 	int ret;
+	int64_t oct;
+	unsigned char mask;
 	int local_refined[8];
 	artio_grid_file *ghandle;
 
@@ -1037,12 +2062,21 @@ int artio_grid_read_oct(artio_fileset *handle,
 	ghandle = handle->grid;
 
 	if (ghandle->cur_level == -1 ||
-			ghandle->cur_octs > ghandle->octs_per_level[ghandle->cur_level - 1] ||
+			ghandle->cur_octs >= ghandle->octs_per_level[ghandle->cur_level - 1] ||
 			(pos != NULL && !ghandle->pos_flag )) {
 		return ARTIO_ERR_INVALID_STATE;
 	}
 
-	if ( variables == NULL ) {
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		oct = ghandle->tree_level_oct[ghandle->cur_level-1] + ghandle->cur_octs;
+		if ( variables != NULL ) {
+			memcpy( variables, &ghandle->tree_variables[8*oct*ghandle->num_grid_variables],
+					8*ghandle->num_grid_variables*sizeof(float) );
+		}
+		for ( i = 0; i < 8; i++ ) {
+			local_refined[i] = ( ghandle->tree_refined[oct] >> i ) & 1;
+		}
+	} else if ( variables == NULL ) {
 		ret = artio_file_fseek(ghandle->ffh[ghandle->cur_file],
 				8*ghandle->num_grid_variables*sizeof(float),
 				ARTIO_SEEK_CUR );
@@ -1054,10 +2088,20 @@ int artio_grid_read_oct(artio_fileset *handle,
 		if ( ret != ARTIO_SUCCESS ) return ret;
 	}
 
-	if ( !ghandle->pos_flag && refined == NULL ) {
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		/* refined flags were unpacked with the variables */
+	} else if ( !ghandle->pos_flag && refined == NULL ) {
 		ret = artio_file_fseek(ghandle->ffh[ghandle->cur_file],
-				8*sizeof(int), ARTIO_SEEK_CUR );
+				ghandle->refined_size, ARTIO_SEEK_CUR );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	} else if ( ghandle->refined_size == 1 ) {
+		ret = artio_file_fread(ghandle->ffh[ghandle->cur_file],
+				&mask, 1, ARTIO_TYPE_CHAR);
 		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		for ( i = 0; i < 8; i++ ) {
+			local_refined[i] = ( mask >> i ) & 1;
+		}
 	} else {
 		ret = artio_file_fread(ghandle->ffh[ghandle->cur_file],
 				local_refined, 8, ARTIO_TYPE_INT);
@@ -1157,21 +2201,96 @@ int artio_grid_read_level_begin(artio_fileset *handle, int level) {
 		}
 	}
 
-	offset = ghandle->sfc_offset_table[ghandle->cur_sfc - ghandle->cache_sfc_begin];
-	offset += sizeof(float) * ghandle->num_grid_variables + sizeof(int)
-			* (ghandle->cur_num_levels + 1);
-	for (i = 0; i < level - 1; i++) {
-		offset += 8 * (sizeof(float) * ghandle->num_grid_variables + sizeof(int))
-				* ghandle->octs_per_level[i];
+	if ( ghandle->compression != ARTIO_GRID_COMPRESSION_NONE ) {
+		/* the whole root tree is unpacked on first access */
+		if ( !ghandle->tree_decoded ) {
+			ret = artio_grid_read_tree( handle );
+			if ( ret != ARTIO_SUCCESS ) return ret;
+		}
+	} else {
+		offset = ghandle->sfc_offset_table[ghandle->cur_sfc - ghandle->cache_sfc_begin];
+		offset += sizeof(float) * ghandle->num_grid_variables + sizeof(int)
+				* (ghandle->cur_num_levels + 1);
+		for (i = 0; i < level - 1; i++) {
+			offset += (8 * sizeof(float) * ghandle->num_grid_variables + ghandle->refined_size)
+					* ghandle->octs_per_level[i];
+		}
+
+		ret = artio_file_fseek(ghandle->ffh[ghandle->cur_file],
+				offset, ARTIO_SEEK_SET);
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
+
+	ghandle->cur_level = level;
+	ghandle->cur_octs = 0;
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Read and unpack the current compressed root tree into the staging
+ * buffers, inverting artio_grid_write_tree.
+ */
+int artio_grid_read_tree( artio_fileset *handle ) {
+	int i, v;
+	int ret;
+	int64_t num_octs, stream_size, offset;
+	unsigned char *p, *packed;
+	artio_grid_file *ghandle = handle->grid;
+
+	ret = artio_grid_tree_reserve( ghandle, ghandle->cur_num_levels,
+			ghandle->octs_per_level );
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	stream_size = ghandle->tree_level_oct[ghandle->cur_num_levels]*
+		(8*ghandle->num_grid_variables*sizeof(float) + 1);
+
+	if ( ghandle->tree_packed_size < 0 ||
+			ghandle->tree_packed_size > artio_lz_bound(stream_size) ) {
+		return ARTIO_ERR_INVALID_COMPRESSION;
+	}
+
+	if ( stream_size + ghandle->tree_packed_size > ghandle->tree_stream_size ) {
+		if ( ghandle->tree_stream != NULL ) free( ghandle->tree_stream );
+		ghandle->tree_stream_size = stream_size + ghandle->tree_packed_size;
+		ghandle->tree_stream = (unsigned char *)malloc( ghandle->tree_stream_size );
+		if ( ghandle->tree_stream == NULL ) {
+			ghandle->tree_stream_size = 0;
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
 	}
+	packed = ghandle->tree_stream + stream_size;
+
+	offset = ghandle->sfc_offset_table[ghandle->cur_sfc - ghandle->cache_sfc_begin] +
+		sizeof(float)*ghandle->num_grid_variables +
+		sizeof(int)*(ghandle->cur_num_levels + 1) + sizeof(int64_t);
 
 	ret = artio_file_fseek(ghandle->ffh[ghandle->cur_file],
 			offset, ARTIO_SEEK_SET);
 	if ( ret != ARTIO_SUCCESS ) return ret;
 
-	ghandle->cur_level = level;
-	ghandle->cur_octs = 0;
+	ret = artio_file_fread(ghandle->ffh[ghandle->cur_file],
+			packed, ghandle->tree_packed_size, ARTIO_TYPE_CHAR);
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	ret = artio_lz_decompress( packed, ghandle->tree_packed_size,
+			ghandle->tree_stream, stream_size );
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	p = ghandle->tree_stream;
+	for ( i = 0; i < ghandle->cur_num_levels; i++ ) {
+		num_octs = ghandle->octs_per_level[i];
+		for ( v = 0; v < ghandle->num_grid_variables; v++ ) {
+			artio_float_planes_decode( p, 8*num_octs, ghandle->num_grid_variables,
+					&ghandle->tree_variables[
+					8*ghandle->tree_level_oct[i]*ghandle->num_grid_variables + v] );
+			p += 8*num_octs*sizeof(float);
+		}
+		memcpy( &ghandle->tree_refined[ghandle->tree_level_oct[i]], p, num_octs );
+		p += num_octs;
+	}
 
+	ghandle->tree_decoded = 1;
 	return ARTIO_SUCCESS;
 }
 
@@ -1224,12 +2343,54 @@ int artio_grid_read_root_cell_end(artio_fileset *handle) {
 	return ARTIO_SUCCESS;
 }
 
+/*
+ * Test whether the cube of half-width size centered on pos overlaps the
+ * region [lpos,rpos), including its periodic images.
+ */
+int artio_grid_region_overlap( artio_fileset *handle, double *pos, double size,
+		double *lpos, double *rpos ) {
+	int i, j;
+	double shift;
+
+	for ( i = 0; i < nDim; i++ ) {
+		for ( j = -1; j <= 1; j++ ) {
+			shift = j*(double)handle->num_grid;
+			if ( pos[i] - size + shift < rpos[i] &&
+					pos[i] + size + shift > lpos[i] ) {
+				break;
+			}
+		}
+		if ( j > 1 ) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
 int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 		int64_t sfc1, int64_t sfc2,
 		int min_level_to_read, int max_level_to_read,
 		int options,
 		artio_grid_callback callback,
 		void *params ) {
+	return artio_grid_read_sfc_range_levels_bounded( handle, sfc1, sfc2,
+			min_level_to_read, max_level_to_read, options,
+			NULL, NULL, callback, params );
+}
+
+/*
+ * Description: Read a segment of oct nodes, skipping any subtree whose
+ *              extent lies outside of [lpos,rpos). Octs outside of the region
+ *              have only their refinement flags read, and descent stops once
+ *              no octs on the next level touch the region. lpos and rpos
+ *              may be NULL to read the complete trees.
+ */
+int artio_grid_read_sfc_range_levels_bounded(artio_fileset *handle,
+		int64_t sfc1, int64_t sfc2,
+		int min_level_to_read, int max_level_to_read,
+		int options, double *lpos, double *rpos,
+		artio_grid_callback callback,
+		void *params ) {
 	int i, j;
 	int64_t sfc;
 	int oct, level;
@@ -1238,6 +2399,8 @@ int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 	int refined;
 	int oct_refined[8];
 	int root_tree_levels;
+	int coords[3];
+	int bounded;
 	float *variables = NULL;
 	double pos[3], cell_pos[3];
 
@@ -1263,6 +2426,7 @@ int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 	}
 
 	ghandle = handle->grid;
+	bounded = ( lpos != NULL && rpos != NULL );
 
 	if ((min_level_to_read < 0) || (min_level_to_read > max_level_to_read)) {
 		return ARTIO_ERR_INVALID_LEVEL;
@@ -1285,6 +2449,17 @@ int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 	}
 
 	for (sfc = sfc1; sfc <= sfc2; sfc++) {
+		if ( bounded ) {
+			/* skip root trees entirely outside the region without reading */
+			artio_sfc_coords( handle, sfc, coords );
+			for ( i = 0; i < 3; i++ ) {
+				pos[i] = (double)coords[i] + 0.5;
+			}
+			if ( !artio_grid_region_overlap( handle, pos, 0.5, lpos, rpos ) ) {
+				continue;
+			}
+		}
+
 		ret = artio_grid_read_root_cell_begin(handle, sfc, pos,
 				variables, &root_tree_levels, octs_per_level);
 		if ( ret != ARTIO_SUCCESS ) {
@@ -1300,8 +2475,9 @@ int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 			callback( sfc, 0, pos, variables, &refined, params );
 		}
 
-		for (level = MAX(min_level_to_read,1);
-				level <= MIN(root_tree_levels,max_level_to_read); level++) {
+		/* positions are placed level by level, so levels above
+		 * min_level_to_read are passed through for their refined flags */
+		for (level = 1; level <= MIN(root_tree_levels,max_level_to_read); level++) {
 			ret = artio_grid_read_level_begin(handle, level);
 			if ( ret != ARTIO_SUCCESS ) {
 				free(octs_per_level);
@@ -1310,6 +2486,21 @@ int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 			}
 
 			for (oct = 0; oct < octs_per_level[level - 1]; oct++) {
+				if ( level < min_level_to_read ||
+						( bounded && !artio_grid_region_overlap( handle,
+						&ghandle->cur_level_pos[3*ghandle->cur_octs],
+						ghandle->cell_size_level, lpos, rpos ) ) ) {
+					/* only the refined flags are needed to place the
+					 * next level's octs */
+					ret = artio_grid_read_oct(handle, NULL, NULL, oct_refined);
+					if ( ret != ARTIO_SUCCESS ) {
+						free(octs_per_level);
+						free(variables);
+						return ret;
+					}
+					continue;
+				}
+
 				ret = artio_grid_read_oct(handle, pos, variables, oct_refined);
 				if ( ret != ARTIO_SUCCESS ) {
 					free(octs_per_level);
@@ -1326,6 +2517,10 @@ int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 							for ( j = 0; j < 3; j++ ) {
 								cell_pos[j] = pos[j] + ghandle->cell_size_level*oct_pos_offsets[i][j];
 							}
+							if ( bounded && !artio_grid_region_overlap( handle, cell_pos,
+									0.5*ghandle->cell_size_level, lpos, rpos ) ) {
+								continue;
+							}
 							callback( sfc, level, cell_pos,
 									&variables[i * ghandle->num_grid_variables],
 									&oct_refined[i], params );
@@ -1333,6 +2528,21 @@ int artio_grid_read_sfc_range_levels(artio_fileset *handle,
 					}
 				}
 			}
+
+			if ( bounded && level < MIN(root_tree_levels,max_level_to_read) ) {
+				/* stop descending once every remaining subtree is outside */
+				for ( oct = 0; oct < ghandle->next_level_oct; oct++ ) {
+					if ( artio_grid_region_overlap( handle,
+							&ghandle->next_level_pos[3*oct],
+							0.5*ghandle->cell_size_level, lpos, rpos ) ) {
+						break;
+					}
+				}
+				if ( oct == ghandle->next_level_oct ) {
+					artio_grid_read_level_end(handle);
+					break;
+				}
+			}
 			artio_grid_read_level_end(handle);
 		}
 		artio_grid_read_root_cell_end(handle);
@@ -1396,8 +2606,10 @@ int artio_grid_read_selection_levels( artio_fileset *handle,
 	while ( artio_selection_iterator( selection,
 				handle->num_root_cells,
 				&start, &end ) == ARTIO_SUCCESS ) {
-		ret = artio_grid_read_sfc_range_levels( handle, start, end,
+		ret = artio_grid_read_sfc_range_levels_bounded( handle, start, end,
 				min_level_to_read, max_level_to_read, options,
+				selection->has_bounds ? selection->lpos : NULL,
+				selection->has_bounds ? selection->rpos : NULL,
 				callback, params);
 		if ( ret != ARTIO_SUCCESS ) return ret;
 	}
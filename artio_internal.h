@@ -38,6 +38,7 @@
 #endif
 
 extern int artio_fh_buffer_size;
+extern int artio_fh_async_buffers;
 
 #define nDim   3
 
@@ -51,6 +52,9 @@ extern int artio_fh_buffer_size;
 /* limit individual writes to 32-bit safe quantity */
 #define ARTIO_IO_MAX    (1<<30)
 
+/* staging size used when file data is copied through memory */
+#define ARTIO_COPY_CHUNK    (1<<22)
+
 #ifdef INT64_MAX
 #define ARTIO_INT64_MAX INT64_MAX
 #else
@@ -77,6 +81,10 @@ typedef struct artio_particle_file_struct {
 	int64_t *sfc_size;
 	int64_t *sfc_list;
 	int64_t sfc_count;
+	/* (sfc, end offset) of root cells whose size is not the distance
+	 * to the next offset in sfc_size, sorted by sfc */
+	int64_t num_sfc_tails;
+	int64_t *sfc_tail;
 
 	/* maintained for consistency and user-error detection */
 	int num_species;
@@ -87,6 +95,13 @@ typedef struct artio_particle_file_struct {
 	int *num_primary_variables;
 	int *num_secondary_variables;
 	int *num_particles_per_species;
+
+	/* per species ARTIO_STORAGE_* of each primary then secondary variable,
+	 * NULL where all are native, and the bytes of variables stored per
+	 * particle; record stages one encoded particle */
+	int **variable_storage;
+	int *variable_size;
+	char *record;
 } artio_particle_file;
 
 typedef struct artio_grid_file_struct {
@@ -104,9 +119,40 @@ typedef struct artio_grid_file_struct {
 	int64_t cache_sfc_end;
 	int64_t *sfc_offset_table;
 
+	/* octs in each root tree, written to <prefix>.goct on close: per
+	 * entry of sfc_list when writing, the open file when reading (NULL
+	 * for filesets written without one) */
+	int64_t *sfc_num_octs;
+	artio_fh *oct_count_fh;
+	/* total octs on each level, accumulated when writing; unknown once
+	 * root cells have been copied without decoding */
+	int64_t *num_octs_per_level;
+	int num_octs_per_level_known;
+
+	/* bytes of refined flags stored per oct: 8 ints, or one bit per cell
+	 * when "grid_packed_refined" is set */
+	int refined_size;
+
+	/* ARTIO_GRID_COMPRESSION_*; compressed root trees are staged whole
+	 * in memory: variables and refined masks (one byte per oct) by level,
+	 * and the encoded record */
+	int compression;
+	int tree_decoded;
+	int64_t tree_packed_size;
+	float *tree_variables;
+	unsigned char *tree_refined;
+	unsigned char *tree_stream;
+	int64_t tree_size;
+	int64_t tree_stream_size;
+	int64_t *tree_level_oct;
+
 	int64_t *sfc_size;
 	int64_t *sfc_list;
 	int64_t sfc_count;
+	/* (sfc, end offset) of root cells whose size is not the distance
+	 * to the next offset in sfc_size, sorted by sfc */
+	int64_t num_sfc_tails;
+	int64_t *sfc_tail;
 
 	int file_max_level;
 	/* maintained for consistency and user-error detection */
@@ -147,6 +193,9 @@ typedef struct parameter_list_struct {
 struct artio_fileset_struct {
 	char file_prefix[256];
 	int endian_swap;
+	/* format version of the files being read or written */
+	int major_version;
+	int minor_version;
 	int open_type;
 	int open_mode;
 	int rank;
@@ -174,9 +223,24 @@ struct artio_selection_struct {
 	int64_t *list;
 	int size;
 	int num_ranges;
+
+	/* ranges which could not be placed in list without shifting it,
+	 * merged into list on the next read (see artio_selection_normalize) */
+	int64_t *pending;
+	int pending_size;
+	int num_pending;
+	int needs_coalesce;
+
 	int cursor;
 	int64_t subcycle;
 	artio_fileset *fileset;
+
+	/* geometric extent of the selection in root cell units (may extend
+	 * past the box for periodic selections), used to prune octs below
+	 * root cell granularity */
+	int has_bounds;
+	double lpos[nDim];
+	double rpos[nDim];
 };
 
 #define ARTIO_FILESET_READ      0
@@ -200,6 +264,7 @@ int artio_file_ftell( artio_fh *handle, int64_t *offset );
 int artio_file_fflush(artio_fh *handle);
 int artio_file_fseek(artio_fh *ffh, int64_t offset, int whence);
 int artio_file_fread(artio_fh *handle, void *buf, int64_t count, int type );
+int artio_file_fcopy(artio_fh *dest, artio_fh *src, int64_t count );
 int artio_file_fclose(artio_fh *handle);
 void artio_file_set_endian_swap_tag(artio_fh *handle);
 int artio_file_get_endian_swap_tag(artio_fh *handle);
@@ -213,6 +278,7 @@ int artio_file_ftell_i( artio_fh *handle, int64_t *offset );
 int artio_file_fflush_i(artio_fh *handle);
 int artio_file_fseek_i(artio_fh *ffh, int64_t offset, int whence);
 int artio_file_fread_i(artio_fh *handle, void *buf, int64_t count, int type );
+int artio_file_fcopy_i(artio_fh *dest, artio_fh *src, int64_t count );
 int artio_file_fclose_i(artio_fh *handle);
 void artio_file_set_endian_swap_tag_i(artio_fh *handle);
 int artio_file_get_endian_swap_tag_i(artio_fh *handle);
@@ -225,7 +291,9 @@ int artio_fileset_distribute_sfc_to_files(
 		int allocation_strategy,
 		char file_suffix,
 		int64_t *file_sfc_index,
-		artio_fh **ffh );
+		artio_fh **ffh,
+		int64_t *num_sfc_tails,
+		int64_t **sfc_tail );
 
 #define ARTIO_ENDIAN_MAGIC 0x1234
 
@@ -242,6 +310,9 @@ int artio_parameter_read(artio_fh *handle, parameter_list *parameters);
 
 int artio_parameter_write(artio_fh *handle, parameter_list *parameters);
 
+int artio_parameter_list_replace(parameter_list *parameters, const char *key, int length,
+		void * value, int type);
+
 int artio_parameter_list_print(parameter_list *parameters);
 int artio_parameter_list_free(parameter_list *parameters);
 int artio_parameter_list_print(parameter_list *parameters);
@@ -254,5 +325,41 @@ int64_t artio_sfc_index( artio_fileset *handle, int coords[nDim] );
 void artio_sfc_coords( artio_fileset *handle, int64_t index, int coords[nDim] );
 
 int artio_find_file( int64_t *file_sfc_index, int num_files, int64_t sfc);
+int artio_sfc_is_tail( int64_t *sfc_list, int64_t num_sfc, int64_t il,
+		int64_t *file_sfc_index, int num_files );
+int64_t artio_sfc_declared_size( int64_t *sfc_list, int64_t *sfc_size,
+		int64_t il, int64_t num_sfc_tails, int64_t *sfc_tail );
+int artio_fileset_partition_writers( int64_t *sfc_list, int64_t num_sfc,
+		int64_t *file_sfc_index, int num_files,
+		int num_writers, int64_t *writer_index );
+artio_fileset *artio_fileset_writer_view( artio_fileset *handle );
+void artio_fileset_free_view( artio_fileset *view );
+
+int64_t artio_lz_bound( int64_t size );
+int64_t artio_lz_compress( const unsigned char *src, int64_t size,
+		unsigned char *dest );
+int artio_lz_decompress( const unsigned char *src, int64_t size,
+		unsigned char *dest, int64_t dest_size );
+void artio_float_planes_encode( const float *values, int64_t count, int stride,
+		unsigned char *planes );
+void artio_float_planes_decode( const unsigned char *planes, int64_t count,
+		int stride, float *values );
+uint16_t artio_float_to_half( float value );
+float artio_half_to_float( uint16_t bits );
+
+int artio_selection_normalize( artio_selection *selection );
+
+int artio_grid_sfc_sizes(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *sfc_sizes );
+int artio_grid_read_sfc_range_levels_bounded(artio_fileset *handle,
+		int64_t sfc1, int64_t sfc2,
+		int min_level_to_read, int max_level_to_read,
+		int options, double *lpos, double *rpos,
+		artio_grid_callback callback,
+		void *params );
+int artio_grid_region_overlap( artio_fileset *handle, double *pos, double size,
+		double *lpos, double *rpos );
+int artio_particle_sfc_sizes(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *sfc_sizes );
 
 #endif /* __ARTIO_INTERNAL_H__ */
@@ -215,6 +215,34 @@ int artio_file_fflush_i(artio_fh *handle) {
 	return ARTIO_SUCCESS;
 }
 
+int artio_file_fcopy_i(artio_fh *dest, artio_fh *src, int64_t count ) {
+	int ret;
+	int64_t size;
+	char *buffer;
+
+	if ( !(src->mode & ARTIO_MODE_READ) || !(dest->mode & ARTIO_MODE_WRITE) ) {
+		return ARTIO_ERR_INVALID_FILE_MODE;
+	}
+
+	buffer = (char *)malloc( MIN( count, ARTIO_COPY_CHUNK ) + 1 );
+	if ( buffer == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	ret = ARTIO_SUCCESS;
+	while ( ret == ARTIO_SUCCESS && count > 0 ) {
+		size = MIN( count, ARTIO_COPY_CHUNK );
+		ret = artio_file_fread_i( src, buffer, size, ARTIO_TYPE_CHAR );
+		if ( ret == ARTIO_SUCCESS ) {
+			ret = artio_file_fwrite_i( dest, buffer, size, ARTIO_TYPE_CHAR );
+		}
+		count -= size;
+	}
+
+	free( buffer );
+	return ret;
+}
+
 int artio_file_fread_i(artio_fh *handle, void *buf, int64_t count, int type ) {
 	MPI_Status status;
 	size_t size, avail, remain;
@@ -190,6 +190,28 @@ int artio_parameter_iterate( artio_fileset *handle,
 	return ARTIO_SUCCESS;
 }
 
+int artio_parameter_iterate_r( artio_fileset *handle, void **cursor,
+		char *key, int *type, int *length ) {
+	parameter *item;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	item = ( *cursor == NULL ) ? handle->parameters->head :
+		((parameter *)*cursor)->next;
+	if ( item == NULL ) {
+		return ARTIO_PARAMETER_EXHAUSTED;
+	}
+
+	strncpy( key, item->key, 64 );
+	*type = item->type;
+	*length = artio_parameter_array_length(item);
+
+	*cursor = item;
+	return ARTIO_SUCCESS;
+}
+
 parameter *artio_parameter_list_search(parameter_list * parameters, const char *key ) {
 	parameter * item = parameters->head;
 	while ( NULL != item && strcmp(item->key, key) ) {
@@ -246,6 +268,26 @@ int artio_parameter_list_insert(parameter_list * parameters, const char * key,
 	return ARTIO_SUCCESS;
 }
 
+/*
+ * Overwrite the value of an existing parameter of the same type and
+ * length, or insert it.  Used for keys set by the library itself.
+ */
+int artio_parameter_list_replace(parameter_list * parameters, const char * key,
+		int length, void *value, int type) {
+	parameter * item = artio_parameter_list_search(parameters, key);
+
+	if ( NULL == item ) {
+		return artio_parameter_list_insert(parameters, key, length, value, type);
+	} else if ( item->type != type ) {
+		return ARTIO_ERR_PARAM_TYPE_MISMATCH;
+	} else if ( item->val_length != length ) {
+		return ARTIO_ERR_PARAM_LENGTH_MISMATCH;
+	}
+
+	memcpy(item->value, value, length * artio_type_size(type));
+	return ARTIO_SUCCESS;
+}
+
 int artio_parameter_list_unpack(parameter_list *parameters, 
 		const char *key, int length,
 		void *value, int type) {
@@ -615,3 +657,42 @@ int artio_parameter_copy(artio_fileset *src, artio_fileset *dest, const char *ke
 int artio_parameter_has_key(artio_fileset *handle, const char *key) {
 	return artio_parameter_list_search(handle->parameters, key) != NULL;
 }
+
+int artio_parameter_pack(artio_fileset *handle, char **buffer, int64_t *size) {
+	int32_t type, bytes;
+	char *p;
+	parameter *item;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	*size = 0;
+	for ( item = handle->parameters->head; item != NULL; item = item->next ) {
+		*size += item->key_length + 1 + 2*sizeof(int32_t) +
+			item->val_length * artio_type_size(item->type);
+	}
+
+	*buffer = (char *)malloc( MAX( 1, *size ) );
+	if ( *buffer == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	p = *buffer;
+	for ( item = handle->parameters->head; item != NULL; item = item->next ) {
+		memcpy( p, item->key, item->key_length + 1 );
+		p += item->key_length + 1;
+
+		type = item->type;
+		bytes = item->val_length * artio_type_size(item->type);
+		memcpy( p, &type, sizeof(int32_t) );
+		p += sizeof(int32_t);
+		memcpy( p, &bytes, sizeof(int32_t) );
+		p += sizeof(int32_t);
+
+		memcpy( p, item->value, bytes );
+		p += bytes;
+	}
+
+	return ARTIO_SUCCESS;
+}
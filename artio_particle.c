@@ -27,17 +27,212 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+
+#define ARTIO_PARTICLE_BULK_CHUNK	(1L<<22)
+#define ARTIO_PARTICLE_COPY_CHUNK	(1L<<16)
 
 const char particle_file_suffix = 'p';
 
 artio_particle_file *artio_particle_file_allocate(void);
 void artio_particle_file_destroy( artio_particle_file *phandle );
 
+static int artio_storage_size( int storage ) {
+	switch ( storage ) {
+		case ARTIO_STORAGE_DOUBLE:
+			return sizeof(double);
+		case ARTIO_STORAGE_FLOAT:
+			return sizeof(float);
+		case ARTIO_STORAGE_HALF:
+			return sizeof(uint16_t);
+		default:
+			return -1;
+	}
+}
+
+static int artio_particle_max_variable_size( artio_particle_file *phandle ) {
+	int i, size = 0;
+
+	for ( i = 0; i < phandle->num_species; i++ ) {
+		size = MAX( size, phandle->variable_size[i] );
+	}
+	return size;
+}
+
+/*
+ * Read the variable storage parameters of every species into phandle,
+ * resolving ARTIO_STORAGE_NATIVE to double (primary) or float (secondary).
+ * Sets *reduced if any variable is stored other than natively.
+ */
+static int artio_particle_setup_storage( artio_fileset *handle,
+		artio_particle_file *phandle, int *reduced ) {
+	int i, v;
+	int ret, size;
+	int num_primary, num_secondary;
+	int native;
+	int *storage;
+	char key[64];
+
+	phandle->variable_storage = (int **)malloc(phandle->num_species * sizeof(int *));
+	phandle->variable_size = (int *)malloc(phandle->num_species * sizeof(int));
+	if ( phandle->variable_storage == NULL || phandle->variable_size == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	for ( i = 0; i < phandle->num_species; i++ ) {
+		phandle->variable_storage[i] = NULL;
+	}
+
+	*reduced = 0;
+	for ( i = 0; i < phandle->num_species; i++ ) {
+		num_primary = phandle->num_primary_variables[i];
+		num_secondary = phandle->num_secondary_variables[i];
+
+		storage = (int *)malloc( MAX( 1, num_primary + num_secondary ) * sizeof(int) );
+		if ( storage == NULL ) {
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+		phandle->variable_storage[i] = storage;
+
+		for ( v = 0; v < num_primary + num_secondary; v++ ) {
+			storage[v] = ARTIO_STORAGE_NATIVE;
+		}
+
+		sprintf( key, "species_%02u_primary_variable_storage", i );
+		ret = artio_parameter_get_int_array( handle, key, num_primary, storage );
+		if ( ret != ARTIO_SUCCESS && ret != ARTIO_ERR_PARAM_NOT_FOUND ) {
+			return ret;
+		}
+
+		sprintf( key, "species_%02u_secondary_variable_storage", i );
+		ret = artio_parameter_get_int_array( handle, key, num_secondary,
+				storage + num_primary );
+		if ( ret != ARTIO_SUCCESS && ret != ARTIO_ERR_PARAM_NOT_FOUND ) {
+			return ret;
+		}
+
+		native = 1;
+		phandle->variable_size[i] = 0;
+		for ( v = 0; v < num_primary + num_secondary; v++ ) {
+			if ( storage[v] == ARTIO_STORAGE_NATIVE ) {
+				storage[v] = ( v < num_primary ) ?
+					ARTIO_STORAGE_DOUBLE : ARTIO_STORAGE_FLOAT;
+			} else if ( storage[v] != ( ( v < num_primary ) ?
+					ARTIO_STORAGE_DOUBLE : ARTIO_STORAGE_FLOAT ) ) {
+				native = 0;
+			}
+
+			size = artio_storage_size( storage[v] );
+			if ( size < 0 ) {
+				return ARTIO_ERR_INVALID_DATATYPE;
+			}
+			phandle->variable_size[i] += size;
+		}
+
+		/* native species are read and written directly */
+		if ( native ) {
+			free( storage );
+			phandle->variable_storage[i] = NULL;
+		} else {
+			*reduced = 1;
+		}
+	}
+
+	if ( *reduced ) {
+		phandle->record = (char *)malloc( artio_particle_max_variable_size( phandle ) );
+		if ( phandle->record == NULL ) {
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+	}
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Encode the variables of particle index, stored every stride values in
+ * primary_variables and secondary_variables, in the storage layout of
+ * species at dest.
+ */
+static void artio_particle_encode( artio_particle_file *phandle, int species,
+		const double *primary_variables, const float *secondary_variables,
+		int64_t index, int64_t stride, char *dest ) {
+	int v;
+	int num_primary = phandle->num_primary_variables[species];
+	int num_variables = num_primary + phandle->num_secondary_variables[species];
+	int *storage = phandle->variable_storage[species];
+	double value;
+	float f;
+	uint16_t h;
+
+	for ( v = 0; v < num_variables; v++ ) {
+		value = ( v < num_primary ) ? primary_variables[v*stride + index] :
+			(double)secondary_variables[(v-num_primary)*stride + index];
+
+		switch ( storage[v] ) {
+			case ARTIO_STORAGE_DOUBLE:
+				memcpy( dest, &value, sizeof(double) );
+				dest += sizeof(double);
+				break;
+			case ARTIO_STORAGE_FLOAT:
+				f = (float)value;
+				memcpy( dest, &f, sizeof(float) );
+				dest += sizeof(float);
+				break;
+			case ARTIO_STORAGE_HALF:
+				h = artio_float_to_half( (float)value );
+				memcpy( dest, &h, sizeof(uint16_t) );
+				dest += sizeof(uint16_t);
+				break;
+		}
+	}
+}
+
+static void artio_particle_decode( artio_particle_file *phandle, int species,
+		const char *src, int endian_swap,
+		double *primary_variables, float *secondary_variables ) {
+	int v;
+	int num_primary = phandle->num_primary_variables[species];
+	int num_variables = num_primary + phandle->num_secondary_variables[species];
+	int *storage = phandle->variable_storage[species];
+	double value = 0.0;
+	float f;
+	uint16_t h;
+
+	for ( v = 0; v < num_variables; v++ ) {
+		switch ( storage[v] ) {
+			case ARTIO_STORAGE_DOUBLE:
+				memcpy( &value, src, sizeof(double) );
+				if ( endian_swap ) artio_double_swap( &value, 1 );
+				src += sizeof(double);
+				break;
+			case ARTIO_STORAGE_FLOAT:
+				memcpy( &f, src, sizeof(float) );
+				if ( endian_swap ) artio_float_swap( &f, 1 );
+				value = f;
+				src += sizeof(float);
+				break;
+			case ARTIO_STORAGE_HALF:
+				memcpy( &h, src, sizeof(uint16_t) );
+				if ( endian_swap ) h = (uint16_t)( (h >> 8) | (h << 8) );
+				value = artio_half_to_float( h );
+				src += sizeof(uint16_t);
+				break;
+		}
+
+		if ( v < num_primary ) {
+			primary_variables[v] = value;
+		} else {
+			secondary_variables[v-num_primary] = (float)value;
+		}
+	}
+}
+
 /*
  * Open existing particle files and add to fileset
  */
 int artio_fileset_open_particles(artio_fileset *handle) {
 	int i;
+	int ret, reduced;
 	char filename[512];
 	int first_file, last_file;
 	int mode;
@@ -79,6 +274,12 @@ int artio_fileset_open_particles(artio_fileset *handle) {
 	artio_parameter_get_int_array(handle, "num_secondary_variables",
 			phandle->num_species, phandle->num_secondary_variables);
 
+	ret = artio_particle_setup_storage( handle, phandle, &reduced );
+	if ( ret != ARTIO_SUCCESS ) {
+		artio_particle_file_destroy(phandle);
+		return ret;
+	}
+
 	phandle->file_sfc_index = (int64_t *)malloc(sizeof(int64_t) * (phandle->num_particle_files + 1));
 	if ( phandle->file_sfc_index == NULL ) {
 		artio_particle_file_destroy(phandle);
@@ -149,7 +350,7 @@ int artio_fileset_add_particles( artio_fileset *handle,
 		char *** secondary_variable_labels_per_species) {
 
 	int i, k;
-	int ret;
+	int ret, reduced, major;
 	int64_t l, cur;
 	int64_t first_file_sfc, last_file_sfc;
 
@@ -221,6 +422,20 @@ int artio_fileset_add_particles( artio_fileset *handle,
 				num_secondary_variables[i], secondary_variable_labels_per_species[i] );
 	}
 
+	ret = artio_particle_setup_storage( handle, phandle, &reduced );
+	if ( ret != ARTIO_SUCCESS ) {
+		artio_particle_file_destroy(phandle);
+		return ret;
+	}
+
+	if ( reduced ) {
+		/* older readers check only the major version */
+		major = ARTIO_COMPRESSED_MAJOR_VERSION;
+		artio_parameter_list_replace(handle->parameters, "ARTIO_MAJOR_VERSION",
+				1, &major, ARTIO_TYPE_INT);
+		handle->major_version = major;
+	}
+
 	/* allocate space for sfc offset cache */
 	phandle->sfc_size = (int64_t *)malloc(handle->num_local_root_cells*sizeof(int64_t));
 	phandle->sfc_list = (int64_t *)malloc(handle->num_local_root_cells*sizeof(int64_t));
@@ -269,8 +484,7 @@ int artio_fileset_add_particle_sfc( artio_fileset *handle, int64_t sfc,
 	size = sizeof(int)*phandle->num_species;
 	for ( i = 0; i < phandle->num_species; i++ ) {
 		size += num_particles_per_species[i]*(sizeof(int64_t) + sizeof(int) +
-					phandle->num_primary_variables[i] * sizeof(double) +
-					phandle->num_secondary_variables[i] * sizeof(float));
+					phandle->variable_size[i]);
 
 		phandle->local_particles_per_species[i] += num_particles_per_species[i];
 	}
@@ -333,7 +547,9 @@ int artio_fileset_commit_particles( artio_fileset *handle ) {
 			phandle->allocation_strategy,
 			particle_file_suffix,
 			phandle->file_sfc_index,
-			phandle->ffh );
+			phandle->ffh,
+			&phandle->num_sfc_tails,
+			&phandle->sfc_tail );
 
 	if ( ret != ARTIO_SUCCESS ) {
 		artio_particle_file_destroy(phandle);
@@ -359,6 +575,8 @@ artio_particle_file *artio_particle_file_allocate(void) {
 		phandle->sfc_size = NULL;
 		phandle->sfc_list = NULL;
 		phandle->sfc_count = -1;
+		phandle->num_sfc_tails = 0;
+		phandle->sfc_tail = NULL;
 		phandle->cache_sfc_begin = -1;
 		phandle->cache_sfc_end = -1;
 		phandle->sfc_offset_table = NULL;
@@ -368,6 +586,9 @@ artio_particle_file *artio_particle_file_allocate(void) {
 		phandle->num_primary_variables = NULL;
 		phandle->num_secondary_variables = NULL;
 		phandle->num_particles_per_species = NULL;
+		phandle->variable_storage = NULL;
+		phandle->variable_size = NULL;
+		phandle->record = NULL;
 		phandle->cur_file = -1;
 		phandle->buffer_size = artio_fh_buffer_size;
 		phandle->buffer = malloc(phandle->buffer_size);
@@ -395,12 +616,21 @@ void artio_particle_file_destroy( artio_particle_file *phandle ) {
 
 	if (phandle->sfc_size != NULL) free( phandle->sfc_size );
 	if (phandle->sfc_list != NULL) free( phandle->sfc_list );
+	if (phandle->sfc_tail != NULL) free( phandle->sfc_tail );
 
 	if (phandle->sfc_offset_table != NULL) free(phandle->sfc_offset_table);
 	if (phandle->num_particles_per_species != NULL) free(phandle->num_particles_per_species);
 	if (phandle->num_primary_variables != NULL) free(phandle->num_primary_variables);
 	if (phandle->num_secondary_variables != NULL) free(phandle->num_secondary_variables);
 	if (phandle->file_sfc_index != NULL) free(phandle->file_sfc_index);
+	if (phandle->variable_storage != NULL) {
+		for (i = 0; i < phandle->num_species; i++) {
+			if (phandle->variable_storage[i] != NULL) free(phandle->variable_storage[i]);
+		}
+		free(phandle->variable_storage);
+	}
+	if (phandle->variable_size != NULL) free(phandle->variable_size);
+	if (phandle->record != NULL) free(phandle->record);
 	if (phandle->buffer != NULL) free(phandle->buffer);
 
 	free(phandle);
@@ -420,6 +650,279 @@ int artio_fileset_close_particles(artio_fileset *handle) {
 	return ARTIO_SUCCESS;
 }
 
+/*
+ * Split the root cells remaining to be written into num_writers handles
+ * which own disjoint sets of particle files, each with its own buffer
+ * (see artio_grid_fork_writers).
+ */
+int artio_particle_fork_writers( artio_fileset *handle, int num_writers,
+		artio_fileset **writers ) {
+	int i, k;
+	int ret;
+	int first_file, last_file;
+	int64_t first, num_sfc;
+	int64_t *writer_index;
+	artio_particle_file *phandle, *vhandle;
+	artio_fileset *view;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_WRITE ||
+			!(handle->open_type & ARTIO_OPEN_PARTICLES) ||
+			handle->particle == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+#ifdef ARTIO_MPI
+	/* file handles are shared with the MPI layer, which is not assumed
+	 * to be thread-safe */
+	return ARTIO_ERR_INVALID_FILESET_MODE;
+#endif /* ARTIO_MPI */
+
+	phandle = handle->particle;
+
+	if ( phandle->sfc_list == NULL || phandle->ffh == NULL ||
+			phandle->cur_sfc != -1 || num_writers <= 0 ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	first = phandle->sfc_count;
+	num_sfc = handle->num_local_root_cells - first;
+
+	writer_index = (int64_t *)malloc( (num_writers+1)*sizeof(int64_t) );
+	if ( writer_index == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	ret = artio_fileset_partition_writers( phandle->sfc_list + first, num_sfc,
+			phandle->file_sfc_index, phandle->num_particle_files,
+			num_writers, writer_index );
+	if ( ret != ARTIO_SUCCESS ) {
+		free( writer_index );
+		return ret;
+	}
+
+	/* writers take over the file buffers */
+	if ( phandle->cur_file != -1 ) {
+		ret = artio_file_detach_buffer( phandle->ffh[phandle->cur_file] );
+		phandle->cur_file = -1;
+		if ( ret != ARTIO_SUCCESS ) {
+			free( writer_index );
+			return ret;
+		}
+	}
+
+	for ( k = 0; k < num_writers; k++ ) {
+		writers[k] = NULL;
+	}
+
+	for ( k = 0; k < num_writers; k++ ) {
+		view = artio_fileset_writer_view( handle );
+		if ( view == NULL ) break;
+		writers[k] = view;
+
+		vhandle = artio_particle_file_allocate();
+		if ( vhandle == NULL ) break;
+		view->particle = vhandle;
+		view->open_type |= ARTIO_OPEN_PARTICLES;
+
+		vhandle->allocation_strategy = phandle->allocation_strategy;
+		vhandle->num_particle_files = phandle->num_particle_files;
+		vhandle->num_species = phandle->num_species;
+		vhandle->num_primary_variables = phandle->num_primary_variables;
+		vhandle->num_secondary_variables = phandle->num_secondary_variables;
+		vhandle->variable_storage = phandle->variable_storage;
+		vhandle->variable_size = phandle->variable_size;
+		vhandle->file_sfc_index = phandle->file_sfc_index;
+		vhandle->sfc_list = phandle->sfc_list + first + writer_index[k];
+		vhandle->sfc_size = phandle->sfc_size + first + writer_index[k];
+		vhandle->num_sfc_tails = phandle->num_sfc_tails;
+		vhandle->sfc_tail = phandle->sfc_tail;
+		vhandle->sfc_count = 0;
+
+		view->num_local_root_cells = writer_index[k+1] - writer_index[k];
+		if ( view->num_local_root_cells > 0 ) {
+			view->proc_sfc_begin = vhandle->sfc_list[0];
+			view->proc_sfc_end = vhandle->sfc_list[view->num_local_root_cells-1];
+		}
+
+		vhandle->num_particles_per_species = (int *)malloc(vhandle->num_species * sizeof(int));
+		vhandle->ffh = (artio_fh **)malloc(vhandle->num_particle_files * sizeof(artio_fh *));
+		if ( vhandle->num_particles_per_species == NULL || vhandle->ffh == NULL ) break;
+
+		if ( phandle->record != NULL ) {
+			vhandle->record = (char *)malloc( artio_particle_max_variable_size( phandle ) );
+			if ( vhandle->record == NULL ) break;
+		}
+
+		/* each file is handed to exactly one writer */
+		for ( i = 0; i < vhandle->num_particle_files; i++ ) {
+			vhandle->ffh[i] = NULL;
+		}
+		if ( view->num_local_root_cells > 0 ) {
+			first_file = artio_find_file( vhandle->file_sfc_index,
+					vhandle->num_particle_files, view->proc_sfc_begin );
+			last_file = artio_find_file( vhandle->file_sfc_index,
+					vhandle->num_particle_files, view->proc_sfc_end );
+			for ( i = first_file; i <= last_file; i++ ) {
+				vhandle->ffh[i] = phandle->ffh[i];
+			}
+		}
+	}
+
+	free( writer_index );
+
+	if ( k < num_writers ) {
+		artio_particle_join_writers( handle, num_writers, writers );
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	/* block writes through the parent until the writers are joined */
+	phandle->sfc_count = handle->num_local_root_cells;
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Flush and release writers created by artio_particle_fork_writers.
+ * Returns ARTIO_ERR_INVALID_STATE if any writer did not write all of its
+ * root cells; the writers are released regardless.
+ */
+int artio_particle_join_writers( artio_fileset *handle, int num_writers,
+		artio_fileset **writers ) {
+	int k;
+	int ret, status;
+	artio_particle_file *vhandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_WRITE ||
+			!(handle->open_type & ARTIO_OPEN_PARTICLES) ||
+			handle->particle == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	status = ARTIO_SUCCESS;
+
+	for ( k = 0; k < num_writers; k++ ) {
+		if ( writers[k] == NULL ) continue;
+		vhandle = writers[k]->particle;
+
+		if ( vhandle != NULL ) {
+			if ( vhandle->cur_file != -1 ) {
+				ret = artio_file_detach_buffer( vhandle->ffh[vhandle->cur_file] );
+				if ( ret != ARTIO_SUCCESS ) status = ret;
+			}
+
+			if ( vhandle->cur_sfc != -1 ||
+					vhandle->sfc_count != writers[k]->num_local_root_cells ) {
+				if ( status == ARTIO_SUCCESS ) status = ARTIO_ERR_INVALID_STATE;
+			}
+
+			/* release only what the writer owns */
+			if ( vhandle->ffh != NULL ) {
+				free( vhandle->ffh );
+				vhandle->ffh = NULL;
+			}
+			vhandle->file_sfc_index = NULL;
+			vhandle->sfc_list = NULL;
+			vhandle->sfc_tail = NULL;
+			vhandle->sfc_size = NULL;
+			vhandle->num_primary_variables = NULL;
+			vhandle->num_secondary_variables = NULL;
+			vhandle->variable_storage = NULL;
+			vhandle->variable_size = NULL;
+			artio_particle_file_destroy( vhandle );
+		}
+
+		artio_fileset_free_view( writers[k] );
+		writers[k] = NULL;
+	}
+
+	return status;
+}
+
+/*
+ * Compute the number of bytes stored on disk for each root cell in
+ * [start,end] from the differences of the particle file offset tables.
+ */
+int artio_particle_sfc_sizes(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *sfc_sizes ) {
+	int ret;
+	int file;
+	int64_t sfc;
+	int64_t offset, next_offset;
+	artio_particle_file *phandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_READ ||
+			!(handle->open_type & ARTIO_OPEN_PARTICLES) ||
+			handle->particle == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	if ( start > end || start < handle->proc_sfc_begin ||
+			end > handle->proc_sfc_end ) {
+		return ARTIO_ERR_INVALID_SFC_RANGE;
+	}
+
+	phandle = handle->particle;
+
+	/* check that we're not in the middle of a read */
+	if ( phandle->cur_sfc != -1 ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	ret = artio_particle_cache_sfc_range( handle, start, end );
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	file = artio_find_file(phandle->file_sfc_index, phandle->num_particle_files, start);
+	/* the cache may hold a larger range than requested */
+	offset = phandle->sfc_offset_table[start - phandle->cache_sfc_begin];
+
+	for ( sfc = start; sfc <= end; sfc++ ) {
+		if ( sfc < phandle->file_sfc_index[file+1] - 1 ) {
+			if ( sfc < end ) {
+				next_offset = phandle->sfc_offset_table[sfc + 1 - phandle->cache_sfc_begin];
+			} else {
+				ret = artio_file_fseek( phandle->ffh[file],
+						(sfc + 1 - phandle->file_sfc_index[file])*sizeof(int64_t),
+						ARTIO_SEEK_SET );
+				if ( ret != ARTIO_SUCCESS ) return ret;
+
+				ret = artio_file_fread( phandle->ffh[file], &next_offset,
+						1, ARTIO_TYPE_LONG );
+				if ( ret != ARTIO_SUCCESS ) return ret;
+			}
+			sfc_sizes[sfc - start] = next_offset - offset;
+		} else {
+			/* last root cell in the file extends to the end of file */
+			ret = artio_file_fseek( phandle->ffh[file], 0, ARTIO_SEEK_END );
+			if ( ret != ARTIO_SUCCESS ) return ret;
+
+			ret = artio_file_ftell( phandle->ffh[file], &next_offset );
+			if ( ret != ARTIO_SUCCESS ) return ret;
+
+			sfc_sizes[sfc - start] = next_offset - offset;
+			file++;
+
+			if ( sfc < end ) {
+				next_offset = phandle->sfc_offset_table[sfc + 1 - phandle->cache_sfc_begin];
+			}
+		}
+		offset = next_offset;
+	}
+
+	return ARTIO_SUCCESS;
+}
+
 int artio_particle_cache_sfc_range(artio_fileset *handle,
 		int64_t start, int64_t end) {
 	int i;
@@ -451,7 +954,7 @@ int artio_particle_cache_sfc_range(artio_fileset *handle,
 		return ARTIO_SUCCESS;
 	}
 
-	artio_grid_clear_sfc_cache(handle);
+	artio_particle_clear_sfc_cache(handle);
 
 	first_file = artio_find_file(phandle->file_sfc_index,
 			phandle->num_particle_files, start);
@@ -576,6 +1079,190 @@ int artio_particle_seek_to_sfc(artio_fileset *handle, int64_t sfc) {
 			offset, ARTIO_SEEK_SET);
 }
 
+int artio_particle_count_in_sfc_range(artio_fileset *handle,
+		int64_t start, int64_t end, int64_t *num_particles_per_species,
+		int *num_particles_per_sfc ) {
+	int i;
+	int ret;
+	int64_t sfc;
+	int *counts;
+	artio_particle_file *phandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_READ ||
+			!(handle->open_type & ARTIO_OPEN_PARTICLES) ||
+			handle->particle == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	phandle = handle->particle;
+
+	/* check that we're not in the middle of a read */
+	if ( phandle->cur_sfc != -1 ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	ret = artio_particle_cache_sfc_range( handle, start, end );
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	for ( i = 0; i < phandle->num_species; i++ ) {
+		num_particles_per_species[i] = 0;
+	}
+
+	counts = phandle->num_particles_per_species;
+	for ( sfc = start; sfc <= end; sfc++ ) {
+		if ( num_particles_per_sfc != NULL ) {
+			counts = num_particles_per_sfc + (sfc - start)*phandle->num_species;
+		}
+
+		/* each root cell begins with its per-species counts */
+		ret = artio_particle_seek_to_sfc( handle, sfc );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		ret = artio_file_fread( phandle->ffh[phandle->cur_file], counts,
+				phandle->num_species, ARTIO_TYPE_INT );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		for ( i = 0; i < phandle->num_species; i++ ) {
+			num_particles_per_species[i] += counts[i];
+		}
+	}
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Copy the root cells [start,end] of src, open for reading, verbatim into
+ * dest, open for writing (see artio_grid_copy_root_cells).  Both filesets
+ * must have the same species and variables.
+ */
+int artio_particle_copy_root_cells(artio_fileset *src, artio_fileset *dest,
+		int64_t start, int64_t end) {
+	int i;
+	int ret = ARTIO_SUCCESS;
+	int src_file, dest_file;
+	int64_t sfc, span_end;
+	int64_t chunk_start, chunk_end;
+	int64_t size;
+	int64_t *sfc_sizes;
+	artio_particle_file *sphandle, *dphandle;
+
+	if ( src == NULL || dest == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if ( src->open_mode != ARTIO_FILESET_READ ||
+			!(src->open_type & ARTIO_OPEN_PARTICLES) ||
+			src->particle == NULL ||
+			dest->open_mode != ARTIO_FILESET_WRITE ||
+			!(dest->open_type & ARTIO_OPEN_PARTICLES) ||
+			dest->particle == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	/* records are copied in the byte order they were written */
+	if ( src->endian_swap ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	if ( start > end || start < src->proc_sfc_begin ||
+			end > src->proc_sfc_end ) {
+		return ARTIO_ERR_INVALID_SFC_RANGE;
+	}
+
+	sphandle = src->particle;
+	dphandle = dest->particle;
+
+	if ( sphandle->cur_sfc != -1 || dphandle->cur_sfc != -1 ||
+			sphandle->num_species != dphandle->num_species ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	for ( i = 0; i < sphandle->num_species; i++ ) {
+		if ( sphandle->num_primary_variables[i] != dphandle->num_primary_variables[i] ||
+				sphandle->num_secondary_variables[i] != dphandle->num_secondary_variables[i] ) {
+			return ARTIO_ERR_INVALID_STATE;
+		}
+
+		/* records are only copied between identical storage layouts */
+		if ( ( sphandle->variable_storage[i] == NULL ) !=
+				( dphandle->variable_storage[i] == NULL ) ||
+				( sphandle->variable_storage[i] != NULL &&
+				memcmp( sphandle->variable_storage[i], dphandle->variable_storage[i],
+					(sphandle->num_primary_variables[i] +
+					 sphandle->num_secondary_variables[i])*sizeof(int) ) != 0 ) ) {
+			return ARTIO_ERR_INVALID_STATE;
+		}
+	}
+
+	sfc_sizes = (int64_t *)malloc( MIN( end - start + 1, ARTIO_PARTICLE_COPY_CHUNK ) *
+			sizeof(int64_t) );
+	if ( sfc_sizes == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	for ( chunk_start = start; chunk_start <= end;
+			chunk_start += ARTIO_PARTICLE_COPY_CHUNK ) {
+		chunk_end = MIN( chunk_start + ARTIO_PARTICLE_COPY_CHUNK - 1, end );
+
+		ret = artio_particle_sfc_sizes( src, chunk_start, chunk_end, sfc_sizes );
+		if ( ret != ARTIO_SUCCESS ) break;
+
+		sfc = chunk_start;
+		while ( sfc <= chunk_end ) {
+			ret = artio_particle_seek_to_sfc( dest, sfc );
+			if ( ret != ARTIO_SUCCESS ) break;
+			dest_file = dphandle->cur_file;
+
+			src_file = artio_find_file( sphandle->file_sfc_index,
+					sphandle->num_particle_files, sfc );
+			ret = artio_file_fseek( sphandle->ffh[src_file],
+					sphandle->sfc_offset_table[sfc - sphandle->cache_sfc_begin],
+					ARTIO_SEEK_SET );
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			/* extend the span while both layouts keep the records adjacent,
+			 * checking each record against the size declared in dest */
+			size = 0;
+			span_end = sfc;
+			for ( ;; ) {
+				if ( artio_sfc_declared_size( dphandle->sfc_list, dphandle->sfc_size,
+						dphandle->sfc_count-1, dphandle->num_sfc_tails,
+						dphandle->sfc_tail ) != sfc_sizes[span_end - chunk_start] ) {
+					/* declared root cell differs from the source */
+					ret = ARTIO_ERR_INVALID_STATE;
+					break;
+				}
+				size += sfc_sizes[span_end - chunk_start];
+
+				if ( span_end == chunk_end ||
+						span_end + 1 >= sphandle->file_sfc_index[src_file+1] ||
+						dphandle->sfc_count >= dest->num_local_root_cells ||
+						dphandle->sfc_list[dphandle->sfc_count] != span_end + 1 ||
+						span_end + 1 >= dphandle->file_sfc_index[dest_file+1] ) {
+					break;
+				}
+				dphandle->sfc_count++;
+				span_end++;
+			}
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			ret = artio_file_fcopy( dphandle->ffh[dest_file],
+					sphandle->ffh[src_file], size );
+			if ( ret != ARTIO_SUCCESS ) break;
+
+			sfc = span_end + 1;
+		}
+		if ( ret != ARTIO_SUCCESS ) break;
+	}
+
+	free( sfc_sizes );
+	return ret;
+}
+
 int artio_particle_write_root_cell_begin(artio_fileset *handle, int64_t sfc,
 		int * num_particles_per_species) {
 	int i;
@@ -722,20 +1409,110 @@ int artio_particle_write_particle(artio_fileset *handle, int64_t pid, int subspe
 	ret = artio_file_fwrite(phandle->ffh[phandle->cur_file], &subspecies, 1, ARTIO_TYPE_INT);
 	if ( ret != ARTIO_SUCCESS ) return ret;
 
-	ret = artio_file_fwrite(phandle->ffh[phandle->cur_file], primary_variables,
-			phandle->num_primary_variables[phandle->cur_species],
-			ARTIO_TYPE_DOUBLE);
-	if ( ret != ARTIO_SUCCESS ) return ret;
+	if ( phandle->variable_storage[phandle->cur_species] != NULL ) {
+		artio_particle_encode( phandle, phandle->cur_species,
+				primary_variables, secondary_variables, 0, 1, phandle->record );
+		ret = artio_file_fwrite(phandle->ffh[phandle->cur_file], phandle->record,
+				phandle->variable_size[phandle->cur_species], ARTIO_TYPE_CHAR);
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	} else {
+		ret = artio_file_fwrite(phandle->ffh[phandle->cur_file], primary_variables,
+				phandle->num_primary_variables[phandle->cur_species],
+				ARTIO_TYPE_DOUBLE);
+		if ( ret != ARTIO_SUCCESS ) return ret;
 
-	ret = artio_file_fwrite(phandle->ffh[phandle->cur_file], secondary_variables,
-			phandle->num_secondary_variables[phandle->cur_species],
-			ARTIO_TYPE_FLOAT);
-	if ( ret != ARTIO_SUCCESS ) return ret;
+		ret = artio_file_fwrite(phandle->ffh[phandle->cur_file], secondary_variables,
+				phandle->num_secondary_variables[phandle->cur_species],
+				ARTIO_TYPE_FLOAT);
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
 
 	phandle->cur_particle++;
 	return ARTIO_SUCCESS;
 }
 
+int artio_particle_write_species_bulk(artio_fileset *handle, int species,
+		int64_t *pid, int *subspecies,
+		double *primary_variables, float *secondary_variables) {
+	int i, v;
+	int ret;
+	int num_primary, num_secondary;
+	int64_t n, num_particles, chunk_particles, count;
+	size_t particle_size;
+	char *staging, *p;
+	artio_particle_file *phandle;
+
+	if ( handle == NULL ) {
+		return ARTIO_ERR_INVALID_HANDLE;
+	}
+
+	if (handle->open_mode != ARTIO_FILESET_WRITE ||
+			!(handle->open_type & ARTIO_OPEN_PARTICLES) ||
+			handle->particle == NULL ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	phandle = handle->particle;
+
+	if (phandle->cur_sfc == -1 || phandle->cur_species != -1 ) {
+		return ARTIO_ERR_INVALID_STATE;
+	}
+
+	if ( species < 0 || species >= phandle->num_species) {
+		return ARTIO_ERR_INVALID_SPECIES;
+	}
+
+	num_particles = phandle->num_particles_per_species[species];
+	num_primary = phandle->num_primary_variables[species];
+	num_secondary = phandle->num_secondary_variables[species];
+
+	/* interleave the per-variable arrays into the on-disk particle
+	 * layout, a chunk at a time */
+	particle_size = sizeof(int64_t) + sizeof(int) + phandle->variable_size[species];
+	chunk_particles = MAX( 1, MIN( num_particles,
+				ARTIO_PARTICLE_BULK_CHUNK / (int64_t)particle_size ) );
+
+	staging = (char *)malloc( chunk_particles*particle_size );
+	if ( staging == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	for ( n = 0; n < num_particles; n += count ) {
+		count = MIN( chunk_particles, num_particles - n );
+		p = staging;
+		for ( i = 0; i < count; i++ ) {
+			memcpy( p, &pid[n+i], sizeof(int64_t) );
+			p += sizeof(int64_t);
+			memcpy( p, &subspecies[n+i], sizeof(int) );
+			p += sizeof(int);
+			if ( phandle->variable_storage[species] != NULL ) {
+				artio_particle_encode( phandle, species, primary_variables,
+						secondary_variables, n+i, num_particles, p );
+				p += phandle->variable_size[species];
+				continue;
+			}
+			for ( v = 0; v < num_primary; v++ ) {
+				memcpy( p, &primary_variables[v*num_particles + n+i], sizeof(double) );
+				p += sizeof(double);
+			}
+			for ( v = 0; v < num_secondary; v++ ) {
+				memcpy( p, &secondary_variables[v*num_particles + n+i], sizeof(float) );
+				p += sizeof(float);
+			}
+		}
+
+		ret = artio_file_fwrite(phandle->ffh[phandle->cur_file],
+				staging, count*particle_size, ARTIO_TYPE_CHAR);
+		if ( ret != ARTIO_SUCCESS ) {
+			free( staging );
+			return ret;
+		}
+	}
+
+	free( staging );
+	return ARTIO_SUCCESS;
+}
+
 /*
  *
  */
@@ -803,15 +1580,24 @@ int artio_particle_read_particle(artio_fileset *handle, int64_t * pid, int *subs
 	ret = artio_file_fread(phandle->ffh[phandle->cur_file], subspecies, 1, ARTIO_TYPE_INT);
 	if ( ret != ARTIO_SUCCESS ) return ret;
 
-	ret = artio_file_fread(phandle->ffh[phandle->cur_file], primary_variables,
-			phandle->num_primary_variables[phandle->cur_species],
-			ARTIO_TYPE_DOUBLE);
-	if ( ret != ARTIO_SUCCESS ) return ret;
+	if ( phandle->variable_storage[phandle->cur_species] != NULL ) {
+		ret = artio_file_fread(phandle->ffh[phandle->cur_file], phandle->record,
+				phandle->variable_size[phandle->cur_species], ARTIO_TYPE_CHAR);
+		if ( ret != ARTIO_SUCCESS ) return ret;
 
-	ret = artio_file_fread(phandle->ffh[phandle->cur_file], secondary_variables,
-			phandle->num_secondary_variables[phandle->cur_species],
-			ARTIO_TYPE_FLOAT);
-	if ( ret != ARTIO_SUCCESS ) return ret;
+		artio_particle_decode( phandle, phandle->cur_species, phandle->record,
+				handle->endian_swap, primary_variables, secondary_variables );
+	} else {
+		ret = artio_file_fread(phandle->ffh[phandle->cur_file], primary_variables,
+				phandle->num_primary_variables[phandle->cur_species],
+				ARTIO_TYPE_DOUBLE);
+		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		ret = artio_file_fread(phandle->ffh[phandle->cur_file], secondary_variables,
+				phandle->num_secondary_variables[phandle->cur_species],
+				ARTIO_TYPE_FLOAT);
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
 
 	phandle->cur_particle++;
 	return ARTIO_SUCCESS;
@@ -850,9 +1636,7 @@ int artio_particle_read_species_begin(artio_fileset *handle, int species) {
 	offset += sizeof(int32_t) * (phandle->num_species);
 
 	for (i = 0; i < species; i++) {
-		offset += ( sizeof(int64_t) + sizeof(int) +
-					phandle->num_primary_variables[i] * sizeof(double) +
-					phandle->num_secondary_variables[i] * sizeof(float) ) *
+		offset += ( sizeof(int64_t) + sizeof(int) + phandle->variable_size[i] ) *
 						phandle->num_particles_per_species[i];
 	}
 
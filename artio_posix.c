@@ -20,6 +20,10 @@
  * <http://www.gnu.org/licenses/>
  **********************************************************************/
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "artio.h"
 #include "artio_internal.h"
 
@@ -31,6 +35,42 @@
 #include <stdint.h>
 #include <assert.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#define ARTIO_ASYNC_WRITES
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/sendfile.h>
+#define ARTIO_KERNEL_COPY
+#if defined(__GLIBC__) && ( __GLIBC__ > 2 || __GLIBC_MINOR__ >= 27 )
+#define ARTIO_COPY_FILE_RANGE
+#endif
+#endif /* __linux__ */
+
+#ifdef ARTIO_ASYNC_WRITES
+/*
+ * Ring of write buffers drained by a background thread.  The buffer
+ * attached by the caller is the first buffer of the ring; while it is
+ * queued for writing the handle fills one of the others.
+ */
+typedef struct artio_async_writer_struct {
+	int num_buffers;
+	char **buffers;
+	int *sizes;
+	int cur;                /* buffer being filled by the caller */
+	int head;               /* oldest buffer queued for writing */
+	int count;              /* number of buffers queued for writing */
+	int error;
+	int exit;
+	int64_t fpos;           /* file offset of the start of the current buffer */
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} artio_async_writer;
+#endif /* ARTIO_ASYNC_WRITES */
+
 struct ARTIO_FH {
 	FILE *fh;
 	int mode;
@@ -38,6 +78,9 @@ struct ARTIO_FH {
 	int bfptr;
 	int bfsize;
 	int bfend;
+#ifdef ARTIO_ASYNC_WRITES
+	artio_async_writer *async;
+#endif /* ARTIO_ASYNC_WRITES */
 };
 
 #ifdef _WIN32
@@ -67,6 +110,9 @@ artio_fh *artio_file_fopen_i( char * filename, int mode, const artio_context *no
 	ffh->bfend = -1;
 	ffh->bfptr = -1;
 	ffh->data = NULL;
+#ifdef ARTIO_ASYNC_WRITES
+	ffh->async = NULL;
+#endif /* ARTIO_ASYNC_WRITES */
 
 	if ( mode & ARTIO_MODE_ACCESS ) {
 		ffh->fh = fopen( filename, ( mode & ARTIO_MODE_WRITE ) ? "w"FOPEN_FLAGS : "r"FOPEN_FLAGS );
@@ -79,6 +125,213 @@ artio_fh *artio_file_fopen_i( char * filename, int mode, const artio_context *no
 	return ffh;
 }
 
+#ifdef ARTIO_ASYNC_WRITES
+void *artio_async_writer_thread( void *arg ) {
+	artio_fh *handle = (artio_fh *)arg;
+	artio_async_writer *async = handle->async;
+	int index, size;
+
+	pthread_mutex_lock( &async->lock );
+	while ( 1 ) {
+		while ( async->count == 0 && !async->exit ) {
+			pthread_cond_wait( &async->cond, &async->lock );
+		}
+		if ( async->count == 0 ) {
+			break;
+		}
+
+		index = async->head;
+		size = async->sizes[index];
+		pthread_mutex_unlock( &async->lock );
+
+		/* only this thread touches the FILE while buffers are queued */
+		if ( fwrite( async->buffers[index], 1, size, handle->fh ) != size ) {
+			pthread_mutex_lock( &async->lock );
+			async->error = ARTIO_ERR_IO_WRITE;
+		} else {
+			pthread_mutex_lock( &async->lock );
+		}
+
+		async->head = (async->head + 1) % async->num_buffers;
+		async->count--;
+		pthread_cond_broadcast( &async->cond );
+	}
+	pthread_mutex_unlock( &async->lock );
+
+	return NULL;
+}
+
+int artio_async_writer_start( artio_fh *handle ) {
+	int i;
+	artio_async_writer *async;
+
+	async = (artio_async_writer *)malloc( sizeof(artio_async_writer) );
+	if ( async == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	async->num_buffers = artio_fh_async_buffers;
+	async->buffers = (char **)malloc( async->num_buffers*sizeof(char *) );
+	async->sizes = (int *)malloc( async->num_buffers*sizeof(int) );
+	if ( async->buffers == NULL || async->sizes == NULL ) {
+		if ( async->buffers != NULL ) free( async->buffers );
+		if ( async->sizes != NULL ) free( async->sizes );
+		free( async );
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	async->buffers[0] = handle->data;
+	for ( i = 1; i < async->num_buffers; i++ ) {
+		async->buffers[i] = (char *)malloc( handle->bfsize );
+		if ( async->buffers[i] == NULL ) {
+			for ( i--; i > 0; i-- ) {
+				free( async->buffers[i] );
+			}
+			free( async->buffers );
+			free( async->sizes );
+			free( async );
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+	}
+
+	async->cur = 0;
+	async->head = 0;
+	async->count = 0;
+	async->error = ARTIO_SUCCESS;
+	async->exit = 0;
+	async->fpos = ftell( handle->fh );
+
+	pthread_mutex_init( &async->lock, NULL );
+	pthread_cond_init( &async->cond, NULL );
+
+	handle->async = async;
+	if ( pthread_create( &async->thread, NULL, artio_async_writer_thread, handle ) != 0 ) {
+		handle->async = NULL;
+		pthread_mutex_destroy( &async->lock );
+		pthread_cond_destroy( &async->cond );
+		for ( i = 1; i < async->num_buffers; i++ ) {
+			free( async->buffers[i] );
+		}
+		free( async->buffers );
+		free( async->sizes );
+		free( async );
+		/* fall back to synchronous writes */
+	}
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Queue the current buffer for writing and switch to the next free one,
+ * waiting for the writer thread if every buffer is in flight.
+ */
+int artio_async_writer_submit( artio_fh *handle ) {
+	artio_async_writer *async = handle->async;
+	int ret;
+
+	pthread_mutex_lock( &async->lock );
+	async->sizes[async->cur] = handle->bfptr;
+	async->count++;
+	async->fpos += handle->bfptr;
+	pthread_cond_broadcast( &async->cond );
+
+	while ( async->count == async->num_buffers ) {
+		pthread_cond_wait( &async->cond, &async->lock );
+	}
+
+	async->cur = (async->cur + 1) % async->num_buffers;
+	ret = async->error;
+	pthread_mutex_unlock( &async->lock );
+
+	handle->data = async->buffers[async->cur];
+	handle->bfptr = 0;
+
+	return ret;
+}
+
+/*
+ * Queue any partial buffer and wait until everything queued has reached
+ * the file.  Once this returns the FILE may be used directly.
+ */
+int artio_async_writer_drain( artio_fh *handle ) {
+	artio_async_writer *async = handle->async;
+	int ret;
+
+	if ( handle->bfptr > 0 ) {
+		ret = artio_async_writer_submit( handle );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
+
+	pthread_mutex_lock( &async->lock );
+	while ( async->count > 0 ) {
+		pthread_cond_wait( &async->cond, &async->lock );
+	}
+	ret = async->error;
+	async->error = ARTIO_SUCCESS;
+	pthread_mutex_unlock( &async->lock );
+
+	return ret;
+}
+
+int artio_async_writer_fseek( artio_fh *handle, int64_t offset, int whence ) {
+	int ret;
+	artio_async_writer *async = handle->async;
+
+	if ( whence == ARTIO_SEEK_CUR ) {
+		offset += async->fpos + handle->bfptr;
+	} else if ( whence != ARTIO_SEEK_SET && whence != ARTIO_SEEK_END ) {
+		return ARTIO_ERR_INVALID_SEEK;
+	}
+
+	/* seeking to the current write position needs no barrier */
+	if ( whence != ARTIO_SEEK_END &&
+			offset == async->fpos + handle->bfptr ) {
+		return ARTIO_SUCCESS;
+	}
+
+	ret = artio_async_writer_drain( handle );
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	if ( whence == ARTIO_SEEK_END ) {
+		fseek( handle->fh, (size_t)offset, SEEK_END );
+	} else {
+		fseek( handle->fh, (size_t)offset, SEEK_SET );
+	}
+	async->fpos = ftell( handle->fh );
+
+	return ARTIO_SUCCESS;
+}
+
+int artio_async_writer_stop( artio_fh *handle ) {
+	int i;
+	int ret;
+	artio_async_writer *async = handle->async;
+
+	ret = artio_async_writer_drain( handle );
+
+	pthread_mutex_lock( &async->lock );
+	async->exit = 1;
+	pthread_cond_broadcast( &async->cond );
+	pthread_mutex_unlock( &async->lock );
+	pthread_join( async->thread, NULL );
+
+	pthread_mutex_destroy( &async->lock );
+	pthread_cond_destroy( &async->cond );
+
+	/* hand the caller's buffer back */
+	handle->data = async->buffers[0];
+	for ( i = 1; i < async->num_buffers; i++ ) {
+		free( async->buffers[i] );
+	}
+	free( async->buffers );
+	free( async->sizes );
+	free( async );
+	handle->async = NULL;
+
+	return ret;
+}
+#endif /* ARTIO_ASYNC_WRITES */
+
 int artio_file_attach_buffer_i( artio_fh *handle, void *buf, int buf_size ) {
 	if ( !(handle->mode & ARTIO_MODE_ACCESS ) ) {
 		return ARTIO_ERR_INVALID_FILE_MODE;
@@ -93,6 +346,13 @@ int artio_file_attach_buffer_i( artio_fh *handle, void *buf, int buf_size ) {
 	handle->bfptr = 0;
 	handle->data = (char *)buf;
 
+#ifdef ARTIO_ASYNC_WRITES
+	if ( handle->mode & ARTIO_MODE_WRITE &&
+			artio_fh_async_buffers > 1 && buf_size > 0 ) {
+		return artio_async_writer_start( handle );
+	}
+#endif /* ARTIO_ASYNC_WRITES */
+
 	return ARTIO_SUCCESS;
 }
 
@@ -101,6 +361,13 @@ int artio_file_detach_buffer_i( artio_fh *handle ) {
 	ret = artio_file_fflush(handle);
 	if ( ret != ARTIO_SUCCESS ) return ret;
 
+#ifdef ARTIO_ASYNC_WRITES
+	if ( handle->async != NULL ) {
+		ret = artio_async_writer_stop( handle );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+	}
+#endif /* ARTIO_ASYNC_WRITES */
+
 	handle->data = NULL;
 	handle->bfsize = -1;
     handle->bfend = -1;
@@ -114,6 +381,9 @@ int artio_file_fwrite_i(artio_fh *handle, const void *buf, int64_t count, int ty
 	int64_t remain;
 	char *p;
 	int size32;
+#ifdef ARTIO_ASYNC_WRITES
+	int ret;
+#endif /* ARTIO_ASYNC_WRITES */
 
 	if ( !(handle->mode & ARTIO_MODE_WRITE) ||
 			!(handle->mode & ARTIO_MODE_ACCESS) ) {
@@ -132,6 +402,26 @@ int artio_file_fwrite_i(artio_fh *handle, const void *buf, int64_t count, int ty
 	remain = count*size;
 	p = (char *)buf;
 
+#ifdef ARTIO_ASYNC_WRITES
+	if ( handle->async != NULL ) {
+		/* everything passes through the ring, the caller may reuse
+		 * buf as soon as we return */
+		while ( remain > 0 ) {
+			size32 = MIN( remain, handle->bfsize - handle->bfptr );
+			memcpy( handle->data + handle->bfptr, p, size32 );
+			handle->bfptr += size32;
+			p += size32;
+			remain -= size32;
+
+			if ( handle->bfptr == handle->bfsize ) {
+				ret = artio_async_writer_submit( handle );
+				if ( ret != ARTIO_SUCCESS ) return ret;
+			}
+		}
+		return ARTIO_SUCCESS;
+	}
+#endif /* ARTIO_ASYNC_WRITES */
+
 	if ( handle->data == NULL ) {
 		/* force writes to 32-bit sizes */
 		while ( remain > 0 ) {
@@ -178,6 +468,11 @@ int artio_file_fflush_i(artio_fh *handle) {
 	}
 
     if ( handle->mode & ARTIO_MODE_WRITE ) {
+#ifdef ARTIO_ASYNC_WRITES
+		if ( handle->async != NULL ) {
+			return artio_async_writer_drain( handle );
+		}
+#endif /* ARTIO_ASYNC_WRITES */
 		if ( handle->bfptr > 0 ) {
 			if ( fwrite( handle->data, 1, handle->bfptr, 
 					handle->fh ) != handle->bfptr ) {
@@ -195,6 +490,108 @@ int artio_file_fflush_i(artio_fh *handle) {
 	return ARTIO_SUCCESS;
 }
 
+#ifdef ARTIO_KERNEL_COPY
+/*
+ * Copy count bytes between two open files inside the kernel, reading from
+ * src_offset and writing at dest_offset.  Returns the number of bytes
+ * copied, which is short when the kernel cannot copy between these files;
+ * the caller completes the copy through memory.
+ */
+int64_t artio_file_kernel_copy( int dest_fd, int64_t dest_offset,
+		int src_fd, int64_t src_offset, int64_t count ) {
+	ssize_t size;
+	off_t in = src_offset;
+	off_t out = dest_offset;
+	int64_t copied = 0;
+
+#ifdef ARTIO_COPY_FILE_RANGE
+	/* may share extents or copy server-side on filesystems supporting it */
+	while ( copied < count ) {
+		size = copy_file_range( src_fd, &in, dest_fd, &out,
+				MIN( count - copied, ARTIO_IO_MAX ), 0 );
+		if ( size <= 0 ) break;
+		copied += size;
+	}
+	if ( copied == count ) {
+		return copied;
+	}
+#endif /* ARTIO_COPY_FILE_RANGE */
+
+	/* sendfile writes at the current position of dest_fd */
+	if ( lseek( dest_fd, out, SEEK_SET ) == (off_t)-1 ) {
+		return copied;
+	}
+	while ( copied < count ) {
+		size = sendfile( dest_fd, src_fd, &in, MIN( count - copied, ARTIO_IO_MAX ) );
+		if ( size <= 0 ) break;
+		copied += size;
+	}
+
+	return copied;
+}
+#endif /* ARTIO_KERNEL_COPY */
+
+int artio_file_fcopy_i(artio_fh *dest, artio_fh *src, int64_t count ) {
+	int ret;
+	int64_t size;
+	char *buffer;
+#ifdef ARTIO_KERNEL_COPY
+	int64_t src_offset, dest_offset;
+#endif /* ARTIO_KERNEL_COPY */
+
+	if ( !(src->mode & ARTIO_MODE_READ) || !(src->mode & ARTIO_MODE_ACCESS) ||
+			!(dest->mode & ARTIO_MODE_WRITE) || !(dest->mode & ARTIO_MODE_ACCESS) ) {
+		return ARTIO_ERR_INVALID_FILE_MODE;
+	}
+
+#ifdef ARTIO_KERNEL_COPY
+	/* asynchronous handles keep their data in flight, copy through them */
+	if ( dest->async == NULL ) {
+		ret = artio_file_ftell_i( src, &src_offset );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+		ret = artio_file_ftell_i( dest, &dest_offset );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		ret = artio_file_fflush_i( dest );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+		if ( fflush( dest->fh ) != 0 ) {
+			return ARTIO_ERR_IO_WRITE;
+		}
+
+		size = artio_file_kernel_copy( fileno(dest->fh), dest_offset,
+				fileno(src->fh), src_offset, count );
+
+		ret = artio_file_fseek_i( src, src_offset + size, ARTIO_SEEK_SET );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+		ret = artio_file_fseek_i( dest, dest_offset + size, ARTIO_SEEK_SET );
+		if ( ret != ARTIO_SUCCESS ) return ret;
+
+		count -= size;
+		if ( count == 0 ) {
+			return ARTIO_SUCCESS;
+		}
+	}
+#endif /* ARTIO_KERNEL_COPY */
+
+	buffer = (char *)malloc( MIN( count, ARTIO_COPY_CHUNK ) + 1 );
+	if ( buffer == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	ret = ARTIO_SUCCESS;
+	while ( ret == ARTIO_SUCCESS && count > 0 ) {
+		size = MIN( count, ARTIO_COPY_CHUNK );
+		ret = artio_file_fread_i( src, buffer, size, ARTIO_TYPE_CHAR );
+		if ( ret == ARTIO_SUCCESS ) {
+			ret = artio_file_fwrite_i( dest, buffer, size, ARTIO_TYPE_CHAR );
+		}
+		count -= size;
+	}
+
+	free( buffer );
+	return ret;
+}
+
 int artio_file_fread_i(artio_fh *handle, void *buf, int64_t count, int type ) {
 	size_t size, avail, remain;
 	int size32;
@@ -282,7 +679,17 @@ int artio_file_fread_i(artio_fh *handle, void *buf, int64_t count, int type ) {
 }
 
 int artio_file_ftell_i( artio_fh *handle, int64_t *offset ) {
-	size_t current = ftell( handle->fh );
+	size_t current;
+
+#ifdef ARTIO_ASYNC_WRITES
+	if ( handle->async != NULL ) {
+		/* the FILE position lags while buffers are in flight */
+		*offset = handle->async->fpos + handle->bfptr;
+		return ARTIO_SUCCESS;
+	}
+#endif /* ARTIO_ASYNC_WRITES */
+
+	current = ftell( handle->fh );
 
 	if ( handle->bfend > 0 ) {
 		current -= handle->bfend;
@@ -298,6 +705,12 @@ int artio_file_ftell_i( artio_fh *handle, int64_t *offset ) {
 int artio_file_fseek_i(artio_fh *handle, int64_t offset, int whence ) {
 	size_t current;
 
+#ifdef ARTIO_ASYNC_WRITES
+	if ( handle->async != NULL ) {
+		return artio_async_writer_fseek( handle, offset, whence );
+	}
+#endif /* ARTIO_ASYNC_WRITES */
+
 	if ( handle->mode & ARTIO_MODE_ACCESS ) {
 		if ( whence == ARTIO_SEEK_CUR ) {
 			if ( offset == 0 ) {
@@ -353,6 +766,11 @@ int artio_file_fseek_i(artio_fh *handle, int64_t offset, int whence ) {
 int artio_file_fclose_i(artio_fh *handle) {
 	if ( handle->mode & ARTIO_MODE_ACCESS ) {
 		artio_file_fflush(handle);
+#ifdef ARTIO_ASYNC_WRITES
+		if ( handle->async != NULL ) {
+			artio_async_writer_stop( handle );
+		}
+#endif /* ARTIO_ASYNC_WRITES */
 		fclose(handle->fh);
 	}
 	free(handle);
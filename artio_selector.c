@@ -31,14 +31,27 @@
 
 #define ARTIO_SELECTION_LIST_SIZE		1024
 #define ARTIO_SELECTION_VOLUME_LIMIT	(1L<<60)
+#define ARTIO_SELECTION_PARTITION_CHUNK	(1L<<16)
 
 int artio_add_volume_to_selection( artio_fileset *handle, int lcoords[3], int rcoords[3],
             int64_t sfcs[8], artio_selection *selection );
+int artio_selection_append_range( artio_selection *selection,
+		int64_t start, int64_t end );
+int artio_selection_range_compare( const void *a, const void *b );
+artio_selection *artio_selection_combine_allocate( artio_selection *a,
+		artio_selection *b );
+int artio_selection_sfc_weights( artio_selection *selection, int open_type,
+		int64_t start, int64_t end, int64_t *weights );
+int artio_selection_partition_fill( artio_selection *selection, int num_parts,
+		int open_type, artio_selection **parts, int64_t *weights );
 
 int artio_selection_iterator( artio_selection *selection, 
 		 int64_t max_range_size, int64_t *start, int64_t *end ) {
+	int ret;
 
 	if ( selection->cursor < 0 ) {
+		ret = artio_selection_normalize( selection );
+		if ( ret != ARTIO_SUCCESS ) return ret;
 		selection->cursor = 0;
 	}
 
@@ -74,6 +87,11 @@ int artio_selection_iterator_reset( artio_selection *selection ) {
 int64_t artio_selection_size( artio_selection *selection ) {
 	int i;
 	int64_t count = 0;
+
+	if ( artio_selection_normalize( selection ) != ARTIO_SUCCESS ) {
+		return -1;
+	}
+
 	for ( i = 0; i < selection->num_ranges; i++ ) {
 		count += selection->list[2*i+1] - selection->list[2*i] + 1;
 	}
@@ -82,18 +100,26 @@ int64_t artio_selection_size( artio_selection *selection ) {
 
 artio_selection *artio_selection_allocate( artio_fileset *handle ) {
 	artio_selection *selection = (artio_selection *)malloc(sizeof(artio_selection));
-	if ( selection != NULL ) {
-		selection->list = (int64_t *)malloc(2*ARTIO_SELECTION_LIST_SIZE*sizeof(int64_t));
-		if ( selection->list == NULL ) {
-			free(selection);
-			return NULL;
-		}
+	if ( selection == NULL ) {
+		return NULL;
 	}
+
+	selection->list = (int64_t *)malloc(2*ARTIO_SELECTION_LIST_SIZE*sizeof(int64_t));
+	if ( selection->list == NULL ) {
+		free(selection);
+		return NULL;
+	}
+
 	selection->subcycle = -1;
 	selection->cursor = -1;
 	selection->size = ARTIO_SELECTION_LIST_SIZE;
 	selection->num_ranges = 0;
+	selection->pending = NULL;
+	selection->pending_size = 0;
+	selection->num_pending = 0;
+	selection->needs_coalesce = 0;
 	selection->fileset = handle;
+	selection->has_bounds = 0;
 	return selection;
 }
 
@@ -105,13 +131,88 @@ int artio_selection_destroy( artio_selection *selection ) {
 	if ( selection->list != NULL ) {
 		free( selection->list );
 	}
+	if ( selection->pending != NULL ) {
+		free( selection->pending );
+	}
 	free(selection);
 	return ARTIO_SUCCESS;
 }
 
+int artio_selection_range_compare( const void *a, const void *b ) {
+	int64_t sa = ((const int64_t *)a)[0];
+	int64_t sb = ((const int64_t *)b)[0];
+	return ( sa > sb ) - ( sa < sb );
+}
+
+/*
+ * Bring the range list back to sorted, disjoint and non-adjacent form by
+ * folding in any pending ranges and coalescing ranges that were extended
+ * into their neighbors.  Called lazily before any operation that reads
+ * the range list.
+ */
+int artio_selection_normalize( artio_selection *selection ) {
+	int i, n;
+	int64_t *new_list;
+
+	if ( selection->num_pending == 0 && !selection->needs_coalesce ) {
+		return ARTIO_SUCCESS;
+	}
+
+	if ( selection->num_pending > 0 ) {
+		if ( selection->num_ranges + selection->num_pending > selection->size ) {
+			n = selection->size;
+			while ( n < selection->num_ranges + selection->num_pending ) {
+				n *= 2;
+			}
+			new_list = (int64_t *)realloc( selection->list, 2*(size_t)n*sizeof(int64_t) );
+			if ( new_list == NULL ) {
+				return ARTIO_ERR_MEMORY_ALLOCATION;
+			}
+			selection->list = new_list;
+			selection->size = n;
+		}
+
+		for ( i = 0; i < selection->num_pending; i++ ) {
+			selection->list[2*(selection->num_ranges+i)] = selection->pending[2*i];
+			selection->list[2*(selection->num_ranges+i)+1] = selection->pending[2*i+1];
+		}
+		selection->num_ranges += selection->num_pending;
+		selection->num_pending = 0;
+
+		qsort( selection->list, selection->num_ranges, 2*sizeof(int64_t),
+				artio_selection_range_compare );
+	}
+
+	/* ranges are sorted by start, merge any that touch */
+	n = 0;
+	for ( i = 1; i < selection->num_ranges; i++ ) {
+		if ( selection->list[2*i] <= selection->list[2*n+1]+1 ) {
+			selection->list[2*n+1] = MAX( selection->list[2*n+1], selection->list[2*i+1] );
+		} else {
+			n++;
+			selection->list[2*n] = selection->list[2*i];
+			selection->list[2*n+1] = selection->list[2*i+1];
+		}
+	}
+	if ( selection->num_ranges > 0 ) {
+		selection->num_ranges = n+1;
+	}
+	selection->needs_coalesce = 0;
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Add the root cells [start,end] to the selection.  Ranges which extend
+ * the last range or follow it are appended in constant time, ranges which
+ * touch an existing range are located by binary search and extend it in
+ * place, and anything else is deferred to the pending list.  Overlapping
+ * ranges are coalesced.
+ */
 int artio_selection_add_range( artio_selection *selection, 
 		int64_t start, int64_t end ) {
-	int i, j;
+	int lo, hi, mid;
+	int n;
 	int64_t *new_list;
 
 	if ( selection == NULL ) {
@@ -122,77 +223,482 @@ int artio_selection_add_range( artio_selection *selection,
 		return ARTIO_ERR_INVALID_SFC_RANGE;
 	}
 
-	for ( i = 0; i < selection->num_ranges; i++ ) {
-		if ( (start >= selection->list[2*i] && start <= selection->list[2*i+1] ) ||
-			 (end >= selection->list[2*i] && end <= selection->list[2*i+1] ) ) {
-			return ARTIO_ERR_INVALID_STATE;
+	/* added cells may lie outside the volume the selection was built from */
+	selection->has_bounds = 0;
+
+	n = selection->num_ranges;
+
+	/* monotone input: append or extend the last range */
+	if ( n == 0 || start >= selection->list[2*n-2] ) {
+		return artio_selection_append_range( selection, start, end );
+	}
+
+	/* locate the first range starting after start */
+	lo = 0;
+	hi = n;
+	while ( lo < hi ) {
+		mid = lo + (hi-lo)/2;
+		if ( selection->list[2*mid] <= start ) {
+			lo = mid+1;
+		} else {
+			hi = mid;
 		}
 	}
 
-	/* locate page */
-	if ( selection->num_ranges == 0 ) {
-		selection->list[0] = start;
-		selection->list[1] = end;
-		selection->num_ranges = 1;
-		return ARTIO_SUCCESS;
+	if ( lo > 0 && start <= selection->list[2*lo-1]+1 ) {
+		/* extends the preceding range */
+		if ( end > selection->list[2*lo-1] ) {
+			selection->list[2*lo-1] = end;
+			if ( end+1 >= selection->list[2*lo] ) {
+				selection->needs_coalesce = 1;
+			}
+		}
+	} else if ( end+1 >= selection->list[2*lo] ) {
+		/* extends the following range downward */
+		selection->list[2*lo] = start;
+		if ( end > selection->list[2*lo+1] ) {
+			selection->list[2*lo+1] = end;
+			if ( lo+1 < n && end+1 >= selection->list[2*lo+2] ) {
+				selection->needs_coalesce = 1;
+			}
+		}
 	} else {
-		/* eventually replace with binary search */
-		for ( i = 0; i < selection->num_ranges; i++ ) {
-			if ( end < selection->list[2*i] ) {
-				break;
+		/* falls in a gap, defer rather than shift the list */
+		if ( selection->num_pending == selection->pending_size ) {
+			n = ( selection->pending_size == 0 ) ?
+				ARTIO_SELECTION_LIST_SIZE : 2*selection->pending_size;
+			new_list = (int64_t *)realloc( selection->pending, 2*(size_t)n*sizeof(int64_t) );
+			if ( new_list == NULL ) {
+				return ARTIO_ERR_MEMORY_ALLOCATION;
 			}
+			selection->pending = new_list;
+			selection->pending_size = n;
 		}
+		selection->pending[2*selection->num_pending] = start;
+		selection->pending[2*selection->num_pending+1] = end;
+		selection->num_pending++;
+	}
 
-		if ( ( i == 0 && end < selection->list[2*i]-1 ) ||
-				( i == selection->num_ranges && start > selection->list[2*i-1]+1 ) ||
-				( end < selection->list[2*i]-1 && start > selection->list[2*i-1]+1 ) ) { 
-			if ( selection->num_ranges == selection->size ) {
-				new_list = (int64_t *)malloc(4*selection->size*sizeof(int64_t));
-				if ( new_list == NULL ) {
-					return ARTIO_ERR_MEMORY_ALLOCATION;
-				}
+	return ARTIO_SUCCESS;	
+}
 
-				for ( j = 0; j < i; j++ ) {
-					new_list[2*j] = selection->list[2*j];
-					new_list[2*j+1] = selection->list[2*j+1];
-				}
-				for ( ; j < selection->num_ranges; j++ ) {
-					new_list[2*j+2] = selection->list[2*j];
-					new_list[2*j+3] = selection->list[2*j+1];
-				}
-				selection->size *= 2;
-				free( selection->list );
-				selection->list = new_list;
-			} else {
-				for ( j = selection->num_ranges-1; j >= i; j-- ) {
-					selection->list[2*j+2] = selection->list[2*j];
-					selection->list[2*j+3] = selection->list[2*j+1];
-				}
-			}
+/*
+ * Add a list of root cells, built in linear time when sfc_list is sorted.
+ * Runs of consecutive indices are added as single ranges.
+ */
+int artio_selection_add_sfc_list( artio_selection *selection,
+		int64_t *sfc_list, int64_t num_sfcs ) {
+	int ret;
+	int64_t i, start;
+
+	if ( selection == NULL ) {
+		return ARTIO_ERR_INVALID_SELECTION;
+	}
+
+	start = 0;
+	for ( i = 1; i <= num_sfcs; i++ ) {
+		if ( i == num_sfcs || sfc_list[i] != sfc_list[i-1]+1 ) {
+			ret = artio_selection_add_range( selection, sfc_list[start], sfc_list[i-1] );
+			if ( ret != ARTIO_SUCCESS ) return ret;
+			start = i;
+		}
+	}
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Append a range that starts at or after every range already in the
+ * selection, coalescing with the last range when they touch.  Used to
+ * build the results of the set operations below in a single pass.
+ */
+int artio_selection_append_range( artio_selection *selection,
+		int64_t start, int64_t end ) {
+	int64_t *new_list;
+	int n = selection->num_ranges;
+
+	if ( n > 0 && start <= selection->list[2*n-1]+1 ) {
+		if ( end > selection->list[2*n-1] ) {
+			selection->list[2*n-1] = end;
+		}
+		return ARTIO_SUCCESS;
+	}
+
+	if ( n == selection->size ) {
+		new_list = (int64_t *)realloc( selection->list,
+				4*(size_t)selection->size*sizeof(int64_t) );
+		if ( new_list == NULL ) {
+			return ARTIO_ERR_MEMORY_ALLOCATION;
+		}
+		selection->list = new_list;
+		selection->size *= 2;
+	}
+
+	selection->list[2*n] = start;
+	selection->list[2*n+1] = end;
+	selection->num_ranges++;
+
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Allocate the result of a binary set operation, checking that both
+ * operands refer to the same root grid.
+ */
+artio_selection *artio_selection_combine_allocate( artio_selection *a,
+		artio_selection *b ) {
+	if ( a == NULL || b == NULL ||
+			a->fileset->num_root_cells != b->fileset->num_root_cells ||
+			artio_selection_normalize( a ) != ARTIO_SUCCESS ||
+			artio_selection_normalize( b ) != ARTIO_SUCCESS ) {
+		return NULL;
+	}
+	return artio_selection_allocate( a->fileset );
+}
+
+artio_selection *artio_selection_union( artio_selection *a, artio_selection *b ) {
+	int i, j, k;
+	int64_t *next;
+	artio_selection *selection;
 
-			selection->list[2*i] = start;
-			selection->list[2*i+1] = end;
-			selection->num_ranges++;
+	selection = artio_selection_combine_allocate( a, b );
+	if ( selection == NULL ) {
+		return NULL;
+	}
+
+	i = j = 0;
+	while ( i < a->num_ranges || j < b->num_ranges ) {
+		if ( j == b->num_ranges ||
+				( i < a->num_ranges && a->list[2*i] <= b->list[2*j] ) ) {
+			next = &a->list[2*i++];
 		} else {
-			if ( end == selection->list[2*i]-1 ) {
-				selection->list[2*i] = start;
-			} else if ( start == selection->list[2*i-1]+1 ) {
-				selection->list[2*i-1] = end;
+			next = &b->list[2*j++];
+		}
+
+		if ( artio_selection_append_range( selection, next[0], next[1] ) != ARTIO_SUCCESS ) {
+			artio_selection_destroy( selection );
+			return NULL;
+		}
+	}
+
+	/* the bounding box of both regions, or unbounded if either is */
+	if ( a->has_bounds && b->has_bounds ) {
+		selection->has_bounds = 1;
+		for ( k = 0; k < nDim; k++ ) {
+			selection->lpos[k] = MIN( a->lpos[k], b->lpos[k] );
+			selection->rpos[k] = MAX( a->rpos[k], b->rpos[k] );
+		}
+	}
+
+	return selection;
+}
+
+artio_selection *artio_selection_intersect( artio_selection *a, artio_selection *b ) {
+	int i, j, k;
+	int64_t start, end;
+	artio_selection *selection;
+	artio_selection *bounds;
+
+	selection = artio_selection_combine_allocate( a, b );
+	if ( selection == NULL ) {
+		return NULL;
+	}
+
+	i = j = 0;
+	while ( i < a->num_ranges && j < b->num_ranges ) {
+		start = MAX( a->list[2*i], b->list[2*j] );
+		end = MIN( a->list[2*i+1], b->list[2*j+1] );
+
+		if ( start <= end &&
+				artio_selection_append_range( selection, start, end ) != ARTIO_SUCCESS ) {
+			artio_selection_destroy( selection );
+			return NULL;
+		}
+
+		/* advance whichever range finishes first */
+		if ( a->list[2*i+1] < b->list[2*j+1] ) {
+			i++;
+		} else {
+			j++;
+		}
+	}
+
+	/* the result lies within either region, so either extent is valid */
+	bounds = a->has_bounds ? a : b;
+	if ( bounds->has_bounds ) {
+		selection->has_bounds = 1;
+		for ( k = 0; k < nDim; k++ ) {
+			selection->lpos[k] = bounds->lpos[k];
+			selection->rpos[k] = bounds->rpos[k];
+		}
+	}
+
+	return selection;
+}
+
+artio_selection *artio_selection_subtract( artio_selection *a, artio_selection *b ) {
+	int i, j, k;
+	int64_t start;
+	artio_selection *selection;
+
+	selection = artio_selection_combine_allocate( a, b );
+	if ( selection == NULL ) {
+		return NULL;
+	}
+
+	j = 0;
+	for ( i = 0; i < a->num_ranges; i++ ) {
+		start = a->list[2*i];
+
+		/* skip ranges of b entirely before the current piece of a */
+		while ( j < b->num_ranges && b->list[2*j+1] < start ) {
+			j++;
+		}
+
+		/* carve out every range of b overlapping this range of a */
+		while ( j < b->num_ranges && b->list[2*j] <= a->list[2*i+1] ) {
+			if ( b->list[2*j] > start &&
+					artio_selection_append_range( selection, start,
+						b->list[2*j]-1 ) != ARTIO_SUCCESS ) {
+				artio_selection_destroy( selection );
+				return NULL;
 			}
+			start = b->list[2*j+1]+1;
+			if ( b->list[2*j+1] > a->list[2*i+1] ) {
+				break;
+			}
+			j++;
+		}
+
+		if ( start <= a->list[2*i+1] &&
+				artio_selection_append_range( selection, start,
+					a->list[2*i+1] ) != ARTIO_SUCCESS ) {
+			artio_selection_destroy( selection );
+			return NULL;
+		}
+	}
+
+	if ( a->has_bounds ) {
+		selection->has_bounds = 1;
+		for ( k = 0; k < nDim; k++ ) {
+			selection->lpos[k] = a->lpos[k];
+			selection->rpos[k] = a->rpos[k];
+		}
+	}
+
+	return selection;
+}
 
-			/* merge 2 ranges if necessary */
-			if ( i > 0 && selection->list[2*i] == selection->list[2*i-1]+1 ) {
-				selection->list[2*i-1] = selection->list[2*i+1];
-				selection->num_ranges--;
-				for ( ; i < selection->num_ranges; i++ ) {
-					selection->list[2*i] = selection->list[2*i+2];
-					selection->list[2*i+1] = selection->list[2*i+3];	
+/*
+ * Weight of each root cell in [start,end] as the number of bytes it
+ * occupies in the requested grid and/or particle files.
+ */
+int artio_selection_sfc_weights( artio_selection *selection, int open_type,
+		int64_t start, int64_t end, int64_t *weights ) {
+	int ret;
+	int64_t i;
+	int64_t *sizes;
+
+	for ( i = 0; i <= end - start; i++ ) {
+		weights[i] = 0;
+	}
+
+	sizes = (int64_t *)malloc( (end - start + 1)*sizeof(int64_t) );
+	if ( sizes == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	if ( open_type & ARTIO_OPEN_GRID ) {
+		ret = artio_grid_sfc_sizes( selection->fileset, start, end, sizes );
+		if ( ret != ARTIO_SUCCESS ) {
+			free( sizes );
+			return ret;
+		}
+		for ( i = 0; i <= end - start; i++ ) {
+			weights[i] += sizes[i];
+		}
+	}
+
+	if ( open_type & ARTIO_OPEN_PARTICLES ) {
+		ret = artio_particle_sfc_sizes( selection->fileset, start, end, sizes );
+		if ( ret != ARTIO_SUCCESS ) {
+			free( sizes );
+			return ret;
+		}
+		for ( i = 0; i <= end - start; i++ ) {
+			weights[i] += sizes[i];
+		}
+	}
+
+	free( sizes );
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Assign the root cells of selection to the preallocated parts, cutting
+ * whenever the running weight passes the next multiple of total/num_parts.
+ */
+int artio_selection_partition_fill( artio_selection *selection, int num_parts,
+		int open_type, artio_selection **parts, int64_t *weights ) {
+	int i, k;
+	int ret;
+	int64_t sfc, start, end, part_start;
+	int64_t total, cumulative, target;
+
+	/* first pass: total weight of the selection */
+	total = 0;
+	for ( i = 0; i < selection->num_ranges; i++ ) {
+		for ( start = selection->list[2*i]; start <= selection->list[2*i+1];
+				start += ARTIO_SELECTION_PARTITION_CHUNK ) {
+			end = MIN( start + ARTIO_SELECTION_PARTITION_CHUNK - 1,
+					selection->list[2*i+1] );
+			ret = artio_selection_sfc_weights( selection, open_type,
+					start, end, weights );
+			if ( ret != ARTIO_SUCCESS ) return ret;
+
+			for ( sfc = start; sfc <= end; sfc++ ) {
+				total += weights[sfc - start];
+			}
+		}
+	}
+
+	/* second pass: assign root cells to parts */
+	k = 0;
+	cumulative = 0;
+	target = (int64_t)((double)total / num_parts);
+	for ( i = 0; i < selection->num_ranges; i++ ) {
+		part_start = selection->list[2*i];
+		for ( start = selection->list[2*i]; start <= selection->list[2*i+1];
+				start += ARTIO_SELECTION_PARTITION_CHUNK ) {
+			end = MIN( start + ARTIO_SELECTION_PARTITION_CHUNK - 1,
+					selection->list[2*i+1] );
+			ret = artio_selection_sfc_weights( selection, open_type,
+					start, end, weights );
+			if ( ret != ARTIO_SUCCESS ) return ret;
+
+			for ( sfc = start; sfc <= end; sfc++ ) {
+				cumulative += weights[sfc - start];
+				if ( k < num_parts-1 && cumulative >= target ) {
+					ret = artio_selection_append_range( parts[k], part_start, sfc );
+					if ( ret != ARTIO_SUCCESS ) return ret;
+					part_start = sfc+1;
+
+					/* a heavy root cell may satisfy several targets */
+					while ( k < num_parts-1 && cumulative >= target ) {
+						k++;
+						target = (int64_t)((double)total * (k+1) / num_parts);
+					}
 				}
 			}
 		}
+
+		if ( part_start <= selection->list[2*i+1] ) {
+			ret = artio_selection_append_range( parts[k], part_start,
+					selection->list[2*i+1] );
+			if ( ret != ARTIO_SUCCESS ) return ret;
+		}
 	}
 
-	return ARTIO_SUCCESS;	
+	return ARTIO_SUCCESS;
+}
+
+/*
+ * Split a selection into num_parts contiguous pieces holding roughly equal
+ * numbers of bytes of grid and/or particle data (open_type is a combination
+ * of ARTIO_OPEN_GRID and ARTIO_OPEN_PARTICLES).  Weights are taken from the
+ * file offset tables, so no root cell data is read.  On success parts[0]
+ * through parts[num_parts-1] hold newly allocated selections, some of which
+ * may be empty when a single root cell outweighs a whole part.  The sfc
+ * ranges cached by the fileset are cached again on return.
+ */
+int artio_selection_partition( artio_selection *selection, int num_parts,
+		int open_type, artio_selection **parts ) {
+	int i, k;
+	int ret, status;
+	int64_t *weights;
+	int64_t grid_cache_begin = -1, grid_cache_end = -1;
+	int64_t particle_cache_begin = -1, particle_cache_end = -1;
+	artio_fileset *handle;
+
+	if ( selection == NULL ) {
+		return ARTIO_ERR_INVALID_SELECTION;
+	}
+
+	handle = selection->fileset;
+
+	if ( num_parts <= 0 || parts == NULL ||
+			!(open_type & (ARTIO_OPEN_GRID | ARTIO_OPEN_PARTICLES)) ||
+			(open_type & ~(ARTIO_OPEN_GRID | ARTIO_OPEN_PARTICLES)) ||
+			(open_type & handle->open_type) != open_type ) {
+		return ARTIO_ERR_INVALID_FILESET_MODE;
+	}
+
+	ret = artio_selection_normalize( selection );
+	if ( ret != ARTIO_SUCCESS ) return ret;
+
+	weights = (int64_t *)malloc( ARTIO_SELECTION_PARTITION_CHUNK*sizeof(int64_t) );
+	if ( weights == NULL ) {
+		return ARTIO_ERR_MEMORY_ALLOCATION;
+	}
+
+	ret = ARTIO_SUCCESS;
+	for ( k = 0; k < num_parts; k++ ) {
+		parts[k] = artio_selection_allocate( handle );
+		if ( parts[k] == NULL ) {
+			ret = ARTIO_ERR_MEMORY_ALLOCATION;
+			continue;
+		}
+		parts[k]->has_bounds = selection->has_bounds;
+		for ( i = 0; i < nDim; i++ ) {
+			parts[k]->lpos[i] = selection->lpos[i];
+			parts[k]->rpos[i] = selection->rpos[i];
+		}
+	}
+
+	/* weights are read through the offset caches, which are restored to
+	 * the ranges the caller had cached */
+	if ( open_type & ARTIO_OPEN_GRID ) {
+		grid_cache_begin = handle->grid->cache_sfc_begin;
+		grid_cache_end = handle->grid->cache_sfc_end;
+	}
+	if ( open_type & ARTIO_OPEN_PARTICLES ) {
+		particle_cache_begin = handle->particle->cache_sfc_begin;
+		particle_cache_end = handle->particle->cache_sfc_end;
+	}
+
+	if ( ret == ARTIO_SUCCESS ) {
+		ret = artio_selection_partition_fill( selection, num_parts,
+				open_type, parts, weights );
+	}
+
+	if ( open_type & ARTIO_OPEN_GRID ) {
+		status = artio_grid_clear_sfc_cache( handle );
+		if ( status == ARTIO_SUCCESS && grid_cache_begin >= 0 ) {
+			status = artio_grid_cache_sfc_range( handle,
+					grid_cache_begin, grid_cache_end );
+		}
+		if ( ret == ARTIO_SUCCESS ) ret = status;
+	}
+	if ( open_type & ARTIO_OPEN_PARTICLES ) {
+		status = artio_particle_clear_sfc_cache( handle );
+		if ( status == ARTIO_SUCCESS && particle_cache_begin >= 0 ) {
+			status = artio_particle_cache_sfc_range( handle,
+					particle_cache_begin, particle_cache_end );
+		}
+		if ( ret == ARTIO_SUCCESS ) ret = status;
+	}
+
+	if ( ret != ARTIO_SUCCESS ) {
+		for ( k = 0; k < num_parts; k++ ) {
+			if ( parts[k] != NULL ) {
+				artio_selection_destroy( parts[k] );
+				parts[k] = NULL;
+			}
+		}
+	}
+
+	free( weights );
+	return ret;
 }
 
 int artio_selection_add_root_cell( artio_selection *selection, int coords[3] ) {
@@ -215,7 +721,8 @@ int artio_selection_add_root_cell( artio_selection *selection, int coords[3] ) {
 
 void artio_selection_print( artio_selection *selection ) {
 	int i;
-	
+
+	artio_selection_normalize( selection );
 	for ( i = 0; i < selection->num_ranges; i++ ) {
 		printf("%u: %"PRId64" %"PRId64"\n", i, selection->list[2*i], selection->list[2*i+1] );
 	}
@@ -281,6 +788,13 @@ artio_selection *artio_select_volume( artio_fileset *handle, double lpos[3], dou
 		}
 	} 
 
+	/* set once the cells are added, which clears any bounds */
+	selection->has_bounds = 1;
+	for ( i = 0; i < 3; i++ ) {
+		selection->lpos[i] = lpos[i];
+		selection->rpos[i] = rpos[i];
+	}
+
 	return selection;
 }
 
@@ -325,6 +839,14 @@ artio_selection *artio_select_cube( artio_fileset *handle, double center[3], dou
 			}
 		}
 	}
- 			
+
+	/* bounds are left unwrapped, readers test periodic images; set once
+	 * the cells are added, which clears any bounds */
+	selection->has_bounds = 1;
+	for ( i = 0; i < 3; i++ ) {
+		selection->lpos[i] = center[i] - 0.5*size;
+		selection->rpos[i] = center[i] + 0.5*size;
+	}
+
 	return selection;
 } 
@@ -0,0 +1,504 @@
+/*
+ * artio_generate: write a synthetic fileset for benchmarks and tests.
+ * Each root cell carries an oct tree whose refinement is either drawn
+ * independently per cell (uniform) or confined to nested spheres about
+ * the box center (zoom), and particles of every species in proportion to
+ * the size of that tree.  All values derive from the seed and the cell
+ * positions through a portable hash, so a given set of options always
+ * produces the same fileset.  Files are written in host byte order, as
+ * the library has no support for writing swapped data.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "artio.h"
+#include "artio_internal.h"
+
+#define MAX_SPECIES			64
+#define MAX_VARIABLES		64
+#define NUM_PRIMARY			6
+#define MAX_LEVEL			30
+
+#define REFINE_UNIFORM		0
+#define REFINE_ZOOM			1
+
+int ret;
+#define CHECK_STATUS(f)		\
+	ret = f; \
+	if ( ret != ARTIO_SUCCESS ) { \
+		fprintf(stderr, "artio failure code %d at %s:%d\n", ret, __FILE__, __LINE__ ); \
+		exit(1); \
+	}
+
+#define allocate(type, size) (type *)allocate_worker((size)*sizeof(type),__FILE__,__LINE__)
+void* allocate_worker(size_t size, const char *file, int line) {
+	void *ptr = NULL;
+
+	if(size > 0) {
+		ptr = malloc(size);
+		if(ptr == NULL) {
+			fprintf(stderr, "Failure allocating %ld bytes in file %s, line %d", size, file, line );
+			exit(1);
+		}
+		memset(ptr, 0, size);
+	}
+	return ptr;
+}
+
+typedef struct {
+	int num_grid;
+	int max_level;
+	int refinement;
+	double fraction;
+	double radius;
+	int num_grid_variables;
+	int num_grid_files;
+	int compress;
+	int num_species;
+	int particles_per_cell;
+	int num_secondary;
+	int num_particle_files;
+	int sfc_type;
+	uint64_t seed;
+} options;
+
+/* oct positions of one root tree, by level */
+typedef struct {
+	int num_levels;
+	int octs_per_level[MAX_LEVEL];
+	int size[MAX_LEVEL];
+	double *pos[MAX_LEVEL];
+} tree;
+
+const double oct_offsets[8][3] = {
+	{ -0.5, -0.5, -0.5 }, {  0.5, -0.5, -0.5 },
+	{ -0.5,  0.5, -0.5 }, {  0.5,  0.5, -0.5 },
+	{ -0.5, -0.5,  0.5 }, {  0.5, -0.5,  0.5 },
+	{ -0.5,  0.5,  0.5 }, {  0.5,  0.5,  0.5 }
+};
+
+uint64_t mix( uint64_t x ) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = ( x ^ (x >> 30) ) * 0xbf58476d1ce4e5b9ULL;
+	x = ( x ^ (x >> 27) ) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/* uniform deviate in [0,1) */
+double uniform( uint64_t *state ) {
+	*state = mix( *state );
+	return (double)(*state >> 11) / 9007199254740992.0;
+}
+
+/* decide whether the cell at level centered on pos is refined */
+int refine( const options *opts, int level, const double pos[3] ) {
+	int i;
+	double r2, d, radius;
+	uint64_t h;
+
+	if ( level >= opts->max_level ) {
+		return 0;
+	}
+
+	if ( opts->refinement == REFINE_ZOOM ) {
+		r2 = 0.0;
+		for ( i = 0; i < 3; i++ ) {
+			d = pos[i] - 0.5*opts->num_grid;
+			r2 += d*d;
+		}
+		radius = opts->radius * opts->num_grid / (double)(1<<level);
+		return r2 < radius*radius;
+	}
+
+	/* cell centers are exact multiples of half the cell size */
+	h = opts->seed ^ (uint64_t)level;
+	for ( i = 0; i < 3; i++ ) {
+		h = mix( h ^ (uint64_t)llround( pos[i] * (double)(2<<level) ) );
+	}
+	return (double)(h >> 11) / 9007199254740992.0 < opts->fraction;
+}
+
+void build_tree( const options *opts, const double root_pos[3], tree *t ) {
+	int i, j, level, oct;
+	double cell_size, cell_pos[3];
+
+	t->num_levels = 0;
+	if ( !refine( opts, 0, root_pos ) ) {
+		return;
+	}
+
+	t->num_levels = 1;
+	t->octs_per_level[0] = 1;
+	memcpy( t->pos[0], root_pos, 3*sizeof(double) );
+
+	for ( level = 1; level < opts->max_level; level++ ) {
+		cell_size = 1.0 / (double)(1<<level);
+		t->octs_per_level[level] = 0;
+
+		for ( oct = 0; oct < t->octs_per_level[level-1]; oct++ ) {
+			for ( i = 0; i < 8; i++ ) {
+				for ( j = 0; j < 3; j++ ) {
+					cell_pos[j] = t->pos[level-1][3*oct+j] + cell_size*oct_offsets[i][j];
+				}
+				if ( refine( opts, level, cell_pos ) ) {
+					if ( t->octs_per_level[level] == t->size[level] ) {
+						t->size[level] *= 2;
+						t->pos[level] = (double *)realloc( t->pos[level],
+								3*t->size[level]*sizeof(double) );
+						if ( t->pos[level] == NULL ) {
+							fprintf(stderr, "Failure allocating level %d octs\n", level );
+							exit(1);
+						}
+					}
+					memcpy( &t->pos[level][3*t->octs_per_level[level]],
+							cell_pos, 3*sizeof(double) );
+					t->octs_per_level[level]++;
+				}
+			}
+		}
+
+		if ( t->octs_per_level[level] == 0 ) {
+			break;
+		}
+		t->num_levels = level+1;
+	}
+}
+
+int64_t tree_octs( const tree *t ) {
+	int level;
+	int64_t num_octs = 0;
+
+	for ( level = 0; level < t->num_levels; level++ ) {
+		num_octs += t->octs_per_level[level];
+	}
+	return num_octs;
+}
+
+void cell_variables( const options *opts, int level, const double pos[3],
+		float *variables ) {
+	int k;
+
+	for ( k = 0; k < opts->num_grid_variables; k++ ) {
+		variables[k] = (float)( (k+1)*(1.0 + level) +
+				sin( 0.1*(k+1)*( pos[0] + 2.0*pos[1] + 3.0*pos[2] ) ) );
+	}
+}
+
+void write_grid( artio_fileset *handle, const options *opts, tree *t,
+		int64_t num_root_cells ) {
+	int i, j, level, oct;
+	int64_t sfc;
+	int coords[3];
+	int refined[8];
+	double root_pos[3], cell_size, cell_pos[3];
+	float *variables = allocate( float, 8*opts->num_grid_variables );
+
+	for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
+		artio_sfc_coords( handle, sfc, coords );
+		for ( i = 0; i < 3; i++ ) {
+			root_pos[i] = coords[i] + 0.5;
+		}
+		build_tree( opts, root_pos, t );
+
+		cell_variables( opts, 0, root_pos, variables );
+		CHECK_STATUS( artio_grid_write_root_cell_begin( handle, sfc, variables,
+				t->num_levels, t->octs_per_level ) );
+		for ( level = 1; level <= t->num_levels; level++ ) {
+			cell_size = 1.0 / (double)(1<<level);
+			CHECK_STATUS( artio_grid_write_level_begin( handle, level ) );
+			for ( oct = 0; oct < t->octs_per_level[level-1]; oct++ ) {
+				for ( i = 0; i < 8; i++ ) {
+					for ( j = 0; j < 3; j++ ) {
+						cell_pos[j] = t->pos[level-1][3*oct+j] + cell_size*oct_offsets[i][j];
+					}
+					cell_variables( opts, level, cell_pos,
+							&variables[i*opts->num_grid_variables] );
+					refined[i] = level < t->num_levels && refine( opts, level, cell_pos );
+				}
+				CHECK_STATUS( artio_grid_write_oct( handle, variables, refined ) );
+			}
+			CHECK_STATUS( artio_grid_write_level_end( handle ) );
+		}
+		CHECK_STATUS( artio_grid_write_root_cell_end( handle ) );
+	}
+
+	free( variables );
+}
+
+void write_particles( artio_fileset *handle, const options *opts, tree *t,
+		int64_t num_root_cells ) {
+	int i, k, s, n;
+	int64_t sfc, pid;
+	int coords[3];
+	int num_particles[MAX_SPECIES];
+	double root_pos[3], primary[NUM_PRIMARY];
+	float secondary[MAX_VARIABLES];
+	uint64_t state;
+
+	pid = 0;
+	for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
+		artio_sfc_coords( handle, sfc, coords );
+		for ( i = 0; i < 3; i++ ) {
+			root_pos[i] = coords[i] + 0.5;
+		}
+		build_tree( opts, root_pos, t );
+		for ( s = 0; s < opts->num_species; s++ ) {
+			num_particles[s] = opts->particles_per_cell*( 1 + tree_octs( t ) );
+		}
+
+		state = mix( opts->seed ^ mix( (uint64_t)sfc ) );
+		CHECK_STATUS( artio_particle_write_root_cell_begin( handle, sfc, num_particles ) );
+		for ( s = 0; s < opts->num_species; s++ ) {
+			CHECK_STATUS( artio_particle_write_species_begin( handle, s ) );
+			for ( n = 0; n < num_particles[s]; n++ ) {
+				for ( i = 0; i < 3; i++ ) {
+					primary[i] = coords[i] + uniform( &state );
+					primary[3+i] = uniform( &state ) - 0.5;
+				}
+				for ( k = 0; k < opts->num_secondary; k++ ) {
+					secondary[k] = (float)uniform( &state );
+				}
+				CHECK_STATUS( artio_particle_write_particle( handle, pid++, s % 2,
+						primary, secondary ) );
+			}
+			CHECK_STATUS( artio_particle_write_species_end( handle ) );
+		}
+		CHECK_STATUS( artio_particle_write_root_cell_end( handle ) );
+	}
+}
+
+void usage( char *name ) {
+	fprintf(stderr,"Usage: %s [options] output_prefix\n"
+		"  -n num_grid          root cells per dimension, a power of two (32)\n"
+		"  -l max_level         deepest refinement level (3)\n"
+		"  -r uniform|zoom      refinement distribution (uniform)\n"
+		"  -f fraction          uniform: chance each cell is refined (0.2)\n"
+		"  -R radius            zoom: level 0 refinement radius in box units,\n"
+		"                       halved at each level (0.25)\n"
+		"  -v num_variables     grid variables per cell (2)\n"
+		"  -g num_grid_files    grid files, 0 for no grid (2)\n"
+		"  -z                   compress the grid\n"
+		"  -s num_species       particle species (2)\n"
+		"  -p num_particles     particles per species per root cell and oct (1)\n"
+		"  -V num_secondary     secondary variables per particle (1)\n"
+		"  -P num_part_files    particle files, 0 for no particles (2)\n"
+		"  -c sfc_type          hilbert, slab_x, slab_y or slab_z (hilbert)\n"
+		"  -S seed              random seed (1)\n", name );
+	exit(1);
+}
+
+int main( int argc, char *argv[] ) {
+	int c, i, s, level;
+	int64_t sfc, num_root_cells, num_octs;
+	int64_t num_octs_per_level[MAX_LEVEL];
+	int coords[3];
+	int num_particles[MAX_SPECIES];
+	int num_primary[MAX_SPECIES], num_secondary[MAX_SPECIES];
+	float species_mass[MAX_SPECIES];
+	double root_pos[3];
+	char *grid_labels[MAX_VARIABLES];
+	char *species_labels[MAX_SPECIES];
+	char *primary_labels[NUM_PRIMARY] = { "POSITION_X", "POSITION_Y", "POSITION_Z",
+		"VELOCITY_X", "VELOCITY_Y", "VELOCITY_Z" };
+	char *secondary_labels[MAX_VARIABLES];
+	char **primary_labels_per_species[MAX_SPECIES];
+	char **secondary_labels_per_species[MAX_SPECIES];
+	char *prefix;
+	options opts;
+	tree t;
+	artio_fileset *handle;
+
+	opts.num_grid = 32;
+	opts.max_level = 3;
+	opts.refinement = REFINE_UNIFORM;
+	opts.fraction = 0.2;
+	opts.radius = 0.25;
+	opts.num_grid_variables = 2;
+	opts.num_grid_files = 2;
+	opts.compress = 0;
+	opts.num_species = 2;
+	opts.particles_per_cell = 1;
+	opts.num_secondary = 1;
+	opts.num_particle_files = 2;
+	opts.sfc_type = ARTIO_SFC_HILBERT;
+	opts.seed = 1;
+
+	while ( ( c = getopt( argc, argv, "n:l:r:f:R:v:g:zs:p:V:P:c:S:" ) ) != -1 ) {
+		switch ( c ) {
+			case 'n': opts.num_grid = atoi(optarg); break;
+			case 'l': opts.max_level = atoi(optarg); break;
+			case 'r':
+				if ( !strcmp( optarg, "uniform" ) ) {
+					opts.refinement = REFINE_UNIFORM;
+				} else if ( !strcmp( optarg, "zoom" ) ) {
+					opts.refinement = REFINE_ZOOM;
+				} else {
+					usage( argv[0] );
+				}
+				break;
+			case 'f': opts.fraction = atof(optarg); break;
+			case 'R': opts.radius = atof(optarg); break;
+			case 'v': opts.num_grid_variables = atoi(optarg); break;
+			case 'g': opts.num_grid_files = atoi(optarg); break;
+			case 'z': opts.compress = 1; break;
+			case 's': opts.num_species = atoi(optarg); break;
+			case 'p': opts.particles_per_cell = atoi(optarg); break;
+			case 'V': opts.num_secondary = atoi(optarg); break;
+			case 'P': opts.num_particle_files = atoi(optarg); break;
+			case 'c':
+				if ( !strcmp( optarg, "hilbert" ) ) {
+					opts.sfc_type = ARTIO_SFC_HILBERT;
+				} else if ( !strcmp( optarg, "slab_x" ) ) {
+					opts.sfc_type = ARTIO_SFC_SLAB_X;
+				} else if ( !strcmp( optarg, "slab_y" ) ) {
+					opts.sfc_type = ARTIO_SFC_SLAB_Y;
+				} else if ( !strcmp( optarg, "slab_z" ) ) {
+					opts.sfc_type = ARTIO_SFC_SLAB_Z;
+				} else {
+					usage( argv[0] );
+				}
+				break;
+			case 'S': opts.seed = strtoull( optarg, NULL, 10 ); break;
+			default: usage( argv[0] );
+		}
+	}
+	if ( optind != argc - 1 ) {
+		usage( argv[0] );
+	}
+	prefix = argv[optind];
+
+	if ( opts.num_grid < 1 || ( opts.num_grid & (opts.num_grid-1) ) ) {
+		fprintf(stderr,"num_grid must be a power of two\n");
+		exit(1);
+	}
+	if ( opts.max_level < 0 || opts.max_level >= MAX_LEVEL ) {
+		fprintf(stderr,"max_level must be between 0 and %d\n", MAX_LEVEL-1 );
+		exit(1);
+	}
+	if ( opts.num_grid_variables < 1 || opts.num_grid_variables > MAX_VARIABLES ||
+			opts.num_secondary < 0 || opts.num_secondary > MAX_VARIABLES ) {
+		fprintf(stderr,"variable counts must be at most %d\n", MAX_VARIABLES );
+		exit(1);
+	}
+	if ( opts.num_species < 1 || opts.num_species > MAX_SPECIES ||
+			opts.particles_per_cell < 0 ) {
+		fprintf(stderr,"num_species must be between 1 and %d\n", MAX_SPECIES );
+		exit(1);
+	}
+	if ( opts.num_grid_files < 0 || opts.num_particle_files < 0 ) {
+		fprintf(stderr,"file counts must not be negative\n");
+		exit(1);
+	}
+
+	for ( level = 0; level < MAX_LEVEL; level++ ) {
+		t.size[level] = 1;
+		t.pos[level] = allocate( double, 3 );
+		num_octs_per_level[level] = 0;
+	}
+
+	num_root_cells = (int64_t)opts.num_grid*opts.num_grid*opts.num_grid;
+	handle = artio_fileset_create( prefix, opts.sfc_type,
+			num_root_cells, num_root_cells, NULL );
+	if ( handle == NULL ) {
+		fprintf(stderr,"Unable to create fileset %s\n", prefix );
+		exit(1);
+	}
+
+	if ( opts.num_grid_files > 0 ) {
+		for ( i = 0; i < opts.num_grid_variables; i++ ) {
+			grid_labels[i] = allocate( char, 64 );
+			sprintf( grid_labels[i], "VARIABLE_%02d", i );
+		}
+		if ( opts.compress ) {
+			CHECK_STATUS( artio_parameter_set_int( handle, "grid_compression",
+					ARTIO_GRID_COMPRESSION_LZ ) );
+		}
+		/* read by artio_validate and CART tools */
+		CHECK_STATUS( artio_parameter_set_int( handle, "max_refinement_level",
+				opts.max_level ) );
+		CHECK_STATUS( artio_fileset_add_grid( handle, opts.num_grid_files,
+				ARTIO_ALLOC_EQUAL_SFC, opts.num_grid_variables, grid_labels ) );
+
+		for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
+			artio_sfc_coords( handle, sfc, coords );
+			for ( i = 0; i < 3; i++ ) {
+				root_pos[i] = coords[i] + 0.5;
+			}
+			build_tree( &opts, root_pos, &t );
+			for ( level = 0; level < t.num_levels; level++ ) {
+				num_octs_per_level[level] += t.octs_per_level[level];
+			}
+			CHECK_STATUS( artio_fileset_add_grid_sfc( handle, sfc,
+					t.num_levels, (int)tree_octs( &t ) ) );
+		}
+		CHECK_STATUS( artio_fileset_commit_grid( handle ) );
+
+		write_grid( handle, &opts, &t, num_root_cells );
+
+		for ( i = 0; i < opts.num_grid_variables; i++ ) {
+			free( grid_labels[i] );
+		}
+	}
+
+	if ( opts.num_particle_files > 0 ) {
+		for ( i = 0; i < opts.num_secondary; i++ ) {
+			secondary_labels[i] = allocate( char, 64 );
+			sprintf( secondary_labels[i], "SECONDARY_%02d", i );
+		}
+		for ( s = 0; s < opts.num_species; s++ ) {
+			species_labels[s] = allocate( char, 64 );
+			sprintf( species_labels[s], "SPECIES_%02d", s );
+			num_primary[s] = NUM_PRIMARY;
+			num_secondary[s] = opts.num_secondary;
+			primary_labels_per_species[s] = primary_labels;
+			secondary_labels_per_species[s] = secondary_labels;
+			species_mass[s] = 1.0 / (float)(s+1);
+		}
+
+		CHECK_STATUS( artio_fileset_add_particles( handle, opts.num_particle_files,
+				ARTIO_ALLOC_EQUAL_SFC, opts.num_species, species_labels,
+				num_primary, num_secondary, primary_labels_per_species,
+				secondary_labels_per_species ) );
+		CHECK_STATUS( artio_parameter_set_float_array( handle,
+				"particle_species_mass", opts.num_species, species_mass ) );
+
+		for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
+			artio_sfc_coords( handle, sfc, coords );
+			for ( i = 0; i < 3; i++ ) {
+				root_pos[i] = coords[i] + 0.5;
+			}
+			build_tree( &opts, root_pos, &t );
+			for ( s = 0; s < opts.num_species; s++ ) {
+				num_particles[s] = opts.particles_per_cell*( 1 + tree_octs( &t ) );
+			}
+			CHECK_STATUS( artio_fileset_add_particle_sfc( handle, sfc, num_particles ) );
+		}
+		CHECK_STATUS( artio_fileset_commit_particles( handle ) );
+
+		write_particles( handle, &opts, &t, num_root_cells );
+
+		for ( i = 0; i < opts.num_secondary; i++ ) {
+			free( secondary_labels[i] );
+		}
+		for ( s = 0; s < opts.num_species; s++ ) {
+			free( species_labels[s] );
+		}
+	}
+
+	CHECK_STATUS( artio_fileset_close( handle ) );
+
+	num_octs = 0;
+	for ( level = 0; level < MAX_LEVEL; level++ ) {
+		if ( num_octs_per_level[level] > 0 ) {
+			printf("level %2d: %ld octs\n", level+1, num_octs_per_level[level] );
+		}
+		num_octs += num_octs_per_level[level];
+		free( t.pos[level] );
+	}
+	printf("%ld root cells, %ld octs\n", num_root_cells, num_octs );
+
+	return 0;
+}
@@ -1,19 +1,32 @@
+/*
+ * artio_remap: re-shard a fileset into a new number of grid and particle
+ * files (or a different allocation strategy).  Root cell records do not
+ * depend on their position within a file, so each output file is filled
+ * by copying contiguous byte spans of the input files; only the offset
+ * tables and the header are rewritten.  Output files are written in
+ * parallel by a pool of threads.
+ */
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h>
-#include <limits.h>
-#include <assert.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #include "artio.h"
+#include "artio_internal.h"
+
+/* root cells whose offsets are held in memory at once, per thread */
+#define REMAP_CHUNK		(1<<20)
 
-int ret;
 #define CHECK_STATUS(f)		\
-	ret = f; \
-	if ( ret != ARTIO_SUCCESS ) { \
-		fprintf(stderr, "artio failure code %d at %s:%d\n", ret, __FILE__, __LINE__ ); \
-		exit(1); \
-	}
+	do { \
+		int ret = f; \
+		if ( ret != ARTIO_SUCCESS ) { \
+			fprintf(stderr, "artio failure code %d at %s:%d\n", ret, __FILE__, __LINE__ ); \
+			exit(1); \
+		} \
+	} while (0)
 
 #define allocate(type, size) (type *)allocate_worker((size)*sizeof(type),__FILE__,__LINE__)
 void* allocate_worker(size_t size, const char *file, int line) {
@@ -30,460 +43,476 @@ void* allocate_worker(size_t size, const char *file, int line) {
 	return ptr;
 }
 
-
-void progress(const char *stage, int64_t num_root_cells, int64_t sfc)
-{
-  if(sfc%1000 == 0)
-    {
-      printf("%s, sfc = %ld (%ld)\r",stage,sfc,num_root_cells);
-      fflush(stdout);
-    }
+double wall_time() {
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + 1e-6*tv.tv_usec;
 }
 
+typedef struct {
+	char *input_prefix;
+	char *output_prefix;
+	char suffix;
+	int num_input_files;
+	int64_t *input_file_sfc_index;
 
-int main( int argc, char *argv[] ) {
-	int i, j;
-	int num_new_files;
-	float jf, f;
-	char key[ARTIO_MAX_STRING_LENGTH];
-	int type, length;
-	int level;
-	int ioct;
-	int total_octs;
-	int64_t num_root_cells, sfc;
-	int num_levels;
-	int *num_octs_per_level;
-	int *num_octs_per_sfc;
-	int *num_levels_per_sfc;
-	int num_vars;
-	int refined[8];
-	float *variables;
-	char **label;
-	int64_t *grid_file_sfc_index;
-	int64_t *new_grid_file_sfc_index;
-	int64_t *particle_file_sfc_index;
-	int64_t *new_particle_file_sfc_index;
-
-	int num_particle_files;
-	int num_grid_files;
-
-	int64_t pid;
-	int num_species;
-	int subspecies;
-	int *num_particles_per_species;
-	int *num_primary_variables;
-	int *num_secondary_variables;
-	int *num_particles_per_species_per_root_tree;
-	char ***primary_variable_labels_per_species;
-	char ***secondary_variable_labels_per_species;
-	char species_label[ARTIO_MAX_STRING_LENGTH];
-
-	double *primary_variables;
-	float *secondary_variables;
-
-	if ( argc != 4 ) {
-		fprintf(stderr,"Usage: %s input_prefix output_prefix num_new_files\n",argv[0]);
-		exit(1);
-	}
+	int num_output_files;
+	int64_t *output_file_sfc_index;
 
-	num_new_files = atoi(argv[3]);
+	int next_file;
+	int error;
+	pthread_mutex_t lock;
+} remap_job;
 
-	artio_fileset *handle = artio_fileset_open( argv[1], 0, NULL );
-	if ( handle == NULL ) {
-		fprintf(stderr,"Unable to open fileset %s\n", argv[1] );
-		exit(1);
-	}
+artio_fh *open_input_file( remap_job *job, int file ) {
+	char filename[1024];
 
-	CHECK_STATUS( artio_parameter_get_long(handle, "num_root_cells", &num_root_cells) );
-
-	artio_fileset *output = artio_fileset_create( argv[2], 0,
-		num_root_cells, 0, num_root_cells-1, NULL );
-	if ( output == NULL ) {
-		fprintf(stderr, "Error creating artio fileset %s\n", argv[2]);
-		exit(1);
-	}
-
-	if ( artio_fileset_has_grid(handle) ) {
-		CHECK_STATUS( artio_fileset_open_grid(handle) );
-
-		CHECK_STATUS( artio_parameter_get_int(handle, "num_grid_files", &num_grid_files) );
-		printf("num_grid_files = %d\n", num_grid_files );
-
-		grid_file_sfc_index = allocate(int64_t, num_grid_files+1);
-		new_grid_file_sfc_index = allocate(int64_t, num_new_files+1);
-		CHECK_STATUS( artio_parameter_get_long_array(handle, "grid_file_sfc_index",
-				num_grid_files+1, grid_file_sfc_index) );
-		for ( i = 0; i <= num_grid_files; i++ ) {
-			printf("grid_file_sfc_index[%d] = %ld\n", i, grid_file_sfc_index[i]);
-		}
-
-		for ( i = 0; i < num_new_files; i++ ) {
-			jf = (float)i*(float)num_grid_files/(float)num_new_files;
-			j = (int)jf;
-			f = jf - floor(jf);
-			new_grid_file_sfc_index[i] = grid_file_sfc_index[j] +
-				(int64_t)(f*(grid_file_sfc_index[j+1] - grid_file_sfc_index[j]));
-		}
-		new_grid_file_sfc_index[num_new_files] = num_root_cells;
-
-		free(grid_file_sfc_index);
+	sprintf( filename, "%s.%c%03d", job->input_prefix, job->suffix, file );
+	return artio_file_fopen( filename, ARTIO_MODE_READ | ARTIO_MODE_ACCESS, NULL );
+}
 
-		for ( i = 0; i <= num_new_files; i++ ) {
-			printf("new_grid_file_sfc_index[%d] = %ld\n", i, new_grid_file_sfc_index[i]);
-		}
+int input_file_error( remap_job *job ) {
+	return ( job->suffix == 'g' ) ? ARTIO_ERR_GRID_FILE_NOT_FOUND :
+		ARTIO_ERR_PARTICLE_FILE_NOT_FOUND;
+}
 
-		assert( new_grid_file_sfc_index[0] == 0 );
-		for ( i = 1; i < num_new_files; i++ ) {
-			assert( new_grid_file_sfc_index[i] > new_grid_file_sfc_index[i-1] );
-		}
-		assert( new_grid_file_sfc_index[num_new_files] == num_root_cells );
+/*
+ * Read the offsets of root cells [first,last] of input file in_file from
+ * its offset table into offset[0,last-first], and the end of the record of
+ * last, which is the next offset or the end of the file, into
+ * offset[last-first+1].
+ */
+int read_record_offsets( remap_job *job, artio_fh *input_fh, int in_file,
+		int64_t first, int64_t last, int64_t *offset ) {
+	int status;
+	int64_t count = last - first + 1;
+
+	status = artio_file_fseek( input_fh,
+			(first - job->input_file_sfc_index[in_file])*sizeof(int64_t),
+			ARTIO_SEEK_SET );
+	if ( status != ARTIO_SUCCESS ) return status;
+
+	if ( last + 1 < job->input_file_sfc_index[in_file+1] ) {
+		return artio_file_fread( input_fh, offset, count+1, ARTIO_TYPE_LONG );
+	}
 
-		/* set new allocation */
-		CHECK_STATUS( artio_parameter_set_long_array(output, "grid_file_sfc_index",
-			num_new_files+1, new_grid_file_sfc_index) );
+	/* last root cell in the file extends to the end of file */
+	status = artio_file_fread( input_fh, offset, count, ARTIO_TYPE_LONG );
+	if ( status != ARTIO_SUCCESS ) return status;
 
-#ifdef ARTIO_REMAP_POSIX
-		/* in this case the number of files equals the number of processes, need
-		 * to override the domain decomposition */
-		CHECK_STATUS( artio_parameter_set_long_array(output, "mpi_task_sfc_index",
-					num_new_files+1, new_grid_file_sfc_index) );
-#endif /* ARTIO_REMAP_POSIX */
+	status = artio_file_fseek( input_fh, 0, ARTIO_SEEK_END );
+	if ( status != ARTIO_SUCCESS ) return status;
 
-		/* determine number of variables */
-		CHECK_STATUS( artio_parameter_get_int(handle, "num_grid_variables", &num_vars) );
+	return artio_file_ftell( input_fh, &offset[count] );
+}
 
-		printf("num_variables = %d\n", num_vars);
+/*
+ * Write output file out_file.  Its root cells are contiguous in the
+ * output, and within each input file they overlap they are contiguous in
+ * the input, so records are copied in byte spans of up to REMAP_CHUNK root
+ * cells, located and sized from the input offset tables, and the output
+ * offset table is filled in as they are.
+ */
+int copy_output_file( remap_job *job, int out_file, int64_t *offset ) {
+	int in_file, open_file;
+	int status;
+	int64_t i, count, size;
+	int64_t sfc, last, begin, end;
+	int64_t span_begin, span_end;
+	int64_t output_offset;
+	char filename[1024];
+	artio_fh *input_fh = NULL;
+	artio_fh *output_fh;
+
+	begin = job->output_file_sfc_index[out_file];
+	end = job->output_file_sfc_index[out_file+1];
+
+	sprintf( filename, "%s.%c%03d", job->output_prefix, job->suffix, out_file );
+	output_fh = artio_file_fopen( filename, ARTIO_MODE_WRITE | ARTIO_MODE_ACCESS, NULL );
+	if ( output_fh == NULL ) {
+		return ARTIO_ERR_FILE_CREATE;
+	}
 
-		/* read grid labels */
-		label = allocate(char *, num_vars);
-		for ( i = 0; i < num_vars; i++ ) {
-			label[i] = allocate(char, ARTIO_MAX_STRING_LENGTH);
+	/* records follow the offset table */
+	output_offset = (end - begin)*sizeof(int64_t);
+
+	status = ARTIO_SUCCESS;
+	open_file = -1;
+	for ( sfc = begin; status == ARTIO_SUCCESS && sfc < end; sfc = last + 1 ) {
+		in_file = artio_find_file( job->input_file_sfc_index, job->num_input_files, sfc );
+		last = MIN( MIN( end, job->input_file_sfc_index[in_file+1] ),
+				sfc + REMAP_CHUNK ) - 1;
+		count = last - sfc + 1;
+
+		if ( in_file != open_file ) {
+			if ( input_fh != NULL ) artio_file_fclose( input_fh );
+			input_fh = open_input_file( job, in_file );
+			if ( input_fh == NULL ) {
+				status = input_file_error( job );
+				break;
+			}
+			open_file = in_file;
 		}
 
-		CHECK_STATUS( artio_parameter_get_string_array(handle, "grid_variable_labels", num_vars, label) );
+		status = read_record_offsets( job, input_fh, in_file, sfc, last, offset );
+		if ( status != ARTIO_SUCCESS ) break;
 
-		for ( i = 0; i < num_vars; i++ ) {
-			printf("variable[%d] = %s\n", i, label[i]);
+		span_begin = offset[0];
+		span_end = offset[count];
+		for ( i = 0; i < count; i++ ) {
+			size = offset[i+1] - offset[i];
+			offset[i] = output_offset;
+			output_offset += size;
 		}
 
-		/* get number of refinement levels */
-		CHECK_STATUS( artio_parameter_get_int(handle, "max_refinement_level", &num_levels) );
+		status = artio_file_fseek( output_fh, (sfc - begin)*sizeof(int64_t), ARTIO_SEEK_SET );
+		if ( status != ARTIO_SUCCESS ) break;
+		status = artio_file_fwrite( output_fh, offset, count, ARTIO_TYPE_LONG );
+		if ( status != ARTIO_SUCCESS ) break;
 
-		printf("num_levels = %d\n", num_levels);
+		status = artio_file_fseek( output_fh, offset[0], ARTIO_SEEK_SET );
+		if ( status != ARTIO_SUCCESS ) break;
+		status = artio_file_fseek( input_fh, span_begin, ARTIO_SEEK_SET );
+		if ( status != ARTIO_SUCCESS ) break;
+		status = artio_file_fcopy( output_fh, input_fh, span_end - span_begin );
+	}
 
-		num_octs_per_level = allocate(int, num_levels);
-		num_octs_per_sfc = allocate(int, num_root_cells);
-		num_levels_per_sfc = allocate(int, num_root_cells);
+	if ( input_fh != NULL ) artio_file_fclose( input_fh );
 
-		CHECK_STATUS( artio_grid_cache_sfc_range(handle, 0, num_root_cells-1) );
+	if ( status == ARTIO_SUCCESS ) {
+		status = artio_file_fclose( output_fh );
+	} else {
+		artio_file_fclose( output_fh );
+	}
+	return status;
+}
 
-		/* loop through all sfc indices to collect refinement information */
-		for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
+void *remap_worker( void *args ) {
+	int out_file;
+	int status;
+	remap_job *job = (remap_job *)args;
+	int64_t *offset = allocate( int64_t, REMAP_CHUNK+1 );
 
-			progress("preparing",num_root_cells,sfc);
+	while ( 1 ) {
+		pthread_mutex_lock( &job->lock );
+		out_file = ( job->error == ARTIO_SUCCESS ) ? job->next_file++ : job->num_output_files;
+		pthread_mutex_unlock( &job->lock );
 
-			CHECK_STATUS( artio_grid_read_root_cell_begin(handle, sfc, NULL, NULL,
-				&num_levels_per_sfc[sfc], num_octs_per_level ) );
-			num_octs_per_sfc[sfc] = 0;
-			for ( level = 0; level < num_levels_per_sfc[sfc]; level++ ) {
-				num_octs_per_sfc[sfc] += num_octs_per_level[level];
-			}
-			CHECK_STATUS( artio_grid_read_root_cell_end(handle) );
-		}
-
-		CHECK_STATUS( artio_fileset_add_grid( output,
-			num_new_files, ARTIO_ALLOC_MANUAL,
-			num_vars, label, num_levels_per_sfc,
-			num_octs_per_sfc ) );
+		if ( out_file >= job->num_output_files ) break;
 
-		for ( i = 0; i < num_vars; i++ ) {
-			free(label[i]);
+		status = copy_output_file( job, out_file, offset );
+		if ( status != ARTIO_SUCCESS ) {
+			pthread_mutex_lock( &job->lock );
+			job->error = status;
+			pthread_mutex_unlock( &job->lock );
 		}
-		free(label);
-
-		variables = allocate(float, 8*num_vars);
-
-		for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
-
-			progress("remapping grid",num_root_cells,sfc);
-
-			CHECK_STATUS( artio_grid_read_root_cell_begin(handle, sfc, NULL, variables, &num_levels, num_octs_per_level ) );
+	}
 
-			if ( num_levels != num_levels_per_sfc[sfc] ) {
-				fprintf(stderr, "Error: number of levels does not match for sfc %ld, %d vs %d\n", sfc, num_levels, num_levels_per_sfc[sfc]);
-				exit(1);
-			}
+	free( offset );
+	return NULL;
+}
 
-			total_octs = 0;
-			for ( level = 0; level < num_levels; level++ ) {
-				total_octs += num_octs_per_level[level];
-			}
+/*
+ * Choose the root cells of each output file as
+ * artio_fileset_distribute_sfc_to_files would, streaming the input offset
+ * tables in chunks for ARTIO_ALLOC_EQUAL_SIZE.
+ */
+void choose_output_files( remap_job *job, int allocation_strategy ) {
+	int in_file, file;
+	int num_files = job->num_output_files;
+	int64_t i, sfc, last, count;
+	int64_t offset, total_size;
+	int64_t num_root_cells = job->input_file_sfc_index[job->num_input_files];
+	int64_t *file_sfc_index = job->output_file_sfc_index;
+	int64_t *buffer;
+	artio_fh *input_fh;
+
+	if ( num_files > num_root_cells ) {
+		CHECK_STATUS( ARTIO_ERR_INVALID_FILE_NUMBER );
+	}
 
-			if ( total_octs != num_octs_per_sfc[sfc] ) {
-				fprintf(stderr, "Error: number of octs does not match for sfc %ld, %d vs %d\n", sfc, total_octs, num_octs_per_sfc[sfc]);
-				for ( level = 0; level < num_levels; level++ ) {
-					fprintf(stderr, "num_octs_per_level[%d] = %d\n", level+1, num_octs_per_level[level]);
-				}
-				exit(1);
-			}
+	if ( allocation_strategy == ARTIO_ALLOC_EQUAL_SFC ) {
+		for ( file = 0; file < num_files; file++ ) {
+			file_sfc_index[file] = (num_root_cells*file+num_files-1) / num_files;
+		}
+		file_sfc_index[num_files] = num_root_cells;
+		return;
+	}
 
-			CHECK_STATUS( artio_grid_write_root_cell_begin(output, sfc, variables, num_levels, num_octs_per_level) );
+	buffer = allocate( int64_t, REMAP_CHUNK+1 );
+
+	/* each root tree is weighted by its size plus its entry in the
+	 * file offset table */
+	total_size = num_root_cells*sizeof(int64_t);
+	for ( in_file = 0; in_file < job->num_input_files; in_file++ ) {
+		sfc = job->input_file_sfc_index[in_file];
+		last = job->input_file_sfc_index[in_file+1] - 1;
+		if ( sfc > last ) continue;
+
+		input_fh = open_input_file( job, in_file );
+		if ( input_fh == NULL ) CHECK_STATUS( input_file_error( job ) );
+		CHECK_STATUS( read_record_offsets( job, input_fh, in_file, sfc, sfc, buffer ) );
+		CHECK_STATUS( artio_file_fseek( input_fh, 0, ARTIO_SEEK_END ) );
+		CHECK_STATUS( artio_file_ftell( input_fh, &offset ) );
+		total_size += offset - buffer[0];
+		artio_file_fclose( input_fh );
+	}
 
-			for ( level = 1; level <= num_levels; level++ ) {
-				CHECK_STATUS( artio_grid_read_level_begin(handle, level) );
-				CHECK_STATUS( artio_grid_write_level_begin(output, level) );
+	for ( file = 1; file < num_files; file++ ) {
+		file_sfc_index[file] = num_root_cells;
+	}
 
-				for ( ioct = 0; ioct < num_octs_per_level[level-1]; ioct++ ) {
-					CHECK_STATUS( artio_grid_read_oct(handle, NULL, variables, refined) );
-					CHECK_STATUS( artio_grid_write_oct(output, variables, refined) );
+	file = 1;
+	offset = 0;
+	for ( in_file = 0; in_file < job->num_input_files && file < num_files; in_file++ ) {
+		input_fh = open_input_file( job, in_file );
+		if ( input_fh == NULL ) CHECK_STATUS( input_file_error( job ) );
+
+		for ( sfc = job->input_file_sfc_index[in_file];
+				sfc < job->input_file_sfc_index[in_file+1] && file < num_files;
+				sfc = last + 1 ) {
+			last = MIN( job->input_file_sfc_index[in_file+1], sfc + REMAP_CHUNK ) - 1;
+			count = last - sfc + 1;
+			CHECK_STATUS( read_record_offsets( job, input_fh, in_file, sfc, last, buffer ) );
+
+			for ( i = 0; i < count && file < num_files; i++ ) {
+				while ( file < num_files &&
+						offset + (sfc+i)*(int64_t)sizeof(int64_t) >=
+						(int64_t)((double)total_size*file/num_files) ) {
+					file_sfc_index[file] = sfc+i;
+					file++;
 				}
-
-				CHECK_STATUS( artio_grid_read_level_end(handle) );
-				CHECK_STATUS( artio_grid_write_level_end(output) );
+				offset += buffer[i+1] - buffer[i];
 			}
-
-			CHECK_STATUS( artio_grid_read_root_cell_end(handle) );
-			CHECK_STATUS( artio_grid_write_root_cell_end(output) );
 		}
 
-		free(variables);
-		free(num_levels_per_sfc);
-		free(num_octs_per_sfc);
-		free(num_octs_per_level);
-
-		CHECK_STATUS( artio_fileset_close_grid(handle) );
-		CHECK_STATUS( artio_fileset_close_grid(output) );
-
-		printf("\ndone writing grid data\n");
+		artio_file_fclose( input_fh );
 	}
 
-	if ( artio_fileset_has_particles(handle) ) {
-		CHECK_STATUS( artio_fileset_open_particles(handle) );
-
-		CHECK_STATUS( artio_parameter_get_int(handle, "num_particle_files", &num_particle_files) );
+	/* every file must hold at least one root cell */
+	file_sfc_index[0] = 0;
+	for ( file = 1; file < num_files; file++ ) {
+		file_sfc_index[file] = MAX( file_sfc_index[file], file_sfc_index[file-1]+1 );
+		file_sfc_index[file] = MIN( file_sfc_index[file],
+				num_root_cells - (num_files - file) );
+	}
+	file_sfc_index[num_files] = num_root_cells;
 
-		printf("num_particles_files = %d\n", num_particle_files);
+	free( buffer );
+}
 
-#ifdef ARTIO_REMAP_POSIX
-		if ( artio_fileset_has_grid(handle) ) {
-			new_particle_file_sfc_index = new_grid_file_sfc_index;
-		} else {
-#endif
-		particle_file_sfc_index = allocate(int64_t, num_particle_files+1);
-		new_particle_file_sfc_index = allocate(int64_t, num_new_files+1);
-		CHECK_STATUS( artio_parameter_get_long_array(handle, "particle_file_sfc_index",
-					num_particle_files+1, particle_file_sfc_index) );
-		for ( i = 0; i <= num_particle_files; i++ ) {
-			printf("particle_file_sfc_index[%d] = %ld\n", i, particle_file_sfc_index[i]);
+/*
+ * Write the data files of one fileset component (grid or particles) into
+ * num_output_files new files, one output file per thread at a time.  Only
+ * the input and output file index and a chunk of offsets per thread are
+ * held in memory.
+ */
+void remap_component( char *input_prefix, char *output_prefix, char suffix,
+		int num_input_files, int64_t *input_file_sfc_index,
+		int num_output_files, int allocation_strategy, int num_threads,
+		int64_t *output_file_sfc_index ) {
+	int i;
+	remap_job job;
+	pthread_t *threads;
+
+	job.input_prefix = input_prefix;
+	job.output_prefix = output_prefix;
+	job.suffix = suffix;
+	job.num_input_files = num_input_files;
+	job.input_file_sfc_index = input_file_sfc_index;
+	job.num_output_files = num_output_files;
+	job.output_file_sfc_index = output_file_sfc_index;
+	job.next_file = 0;
+	job.error = ARTIO_SUCCESS;
+	pthread_mutex_init( &job.lock, NULL );
+
+	choose_output_files( &job, allocation_strategy );
+
+	num_threads = MIN( num_threads, num_output_files );
+	threads = allocate( pthread_t, num_threads );
+	for ( i = 0; i < num_threads; i++ ) {
+		if ( pthread_create( &threads[i], NULL, remap_worker, &job ) != 0 ) {
+			fprintf(stderr, "Unable to start copy thread\n");
+			exit(1);
 		}
+	}
+	for ( i = 0; i < num_threads; i++ ) {
+		pthread_join( threads[i], NULL );
+	}
+	pthread_mutex_destroy( &job.lock );
 
-		for ( i = 0; i < num_new_files; i++ ) {
-			jf = (float)i*(float)num_particle_files/(float)num_new_files;
-			j = (int)jf;
-			f = jf - floor(jf);
-			new_particle_file_sfc_index[i] = particle_file_sfc_index[j] +
-				(int64_t)(f*(particle_file_sfc_index[j+1] - particle_file_sfc_index[j]));
-		}
-		new_particle_file_sfc_index[num_new_files] = num_root_cells;
+	CHECK_STATUS( job.error );
 
-		free(particle_file_sfc_index);
+	free( threads );
+}
 
-		for ( i = 0; i <= num_new_files; i++ ) {
-			printf("new_particle_file_sfc_index[%d] = %ld\n", i, new_particle_file_sfc_index[i]);
-		}
+/*
+ * Copy the grid oct counts file, which is indexed by sfc and so does not
+ * depend on how root cells are divided among files.
+ */
+int copy_oct_counts( char *input_prefix, char *output_prefix ) {
+	int status;
+	int64_t size;
+	char filename[1024];
+	artio_fh *input_fh, *output_fh;
+
+	sprintf( filename, "%s.goct", input_prefix );
+	input_fh = artio_file_fopen( filename, ARTIO_MODE_READ | ARTIO_MODE_ACCESS, NULL );
+	if ( input_fh == NULL ) {
+		return ARTIO_ERR_GRID_FILE_NOT_FOUND;
+	}
 
-		assert( new_particle_file_sfc_index[0] == 0 );
-		for ( i = 1; i < num_new_files; i++ ) {
-			assert( new_particle_file_sfc_index[i] > new_particle_file_sfc_index[i-1] );
-		}
-		assert( new_particle_file_sfc_index[num_new_files] == num_root_cells );
+	sprintf( filename, "%s.goct", output_prefix );
+	output_fh = artio_file_fopen( filename, ARTIO_MODE_WRITE | ARTIO_MODE_ACCESS, NULL );
+	if ( output_fh == NULL ) {
+		artio_file_fclose( input_fh );
+		return ARTIO_ERR_FILE_CREATE;
+	}
 
-#ifdef ARTIO_REMAP_POSIX
-		/* in this case the number of files equals the number of processes, need
-		 * to override the domain decomposition */
-		CHECK_STATUS( artio_parameter_set_long_array(output, "mpi_task_sfc_index",
-					num_new_files+1, new_particle_file_sfc_index) );
-		} /* artio_fileset has grid */
-#endif /* ARTIO_REMAP_POSIX */
+	status = artio_file_fseek( input_fh, 0, ARTIO_SEEK_END );
+	if ( status == ARTIO_SUCCESS ) {
+		status = artio_file_ftell( input_fh, &size );
+	}
+	if ( status == ARTIO_SUCCESS ) {
+		status = artio_file_fseek( input_fh, 0, ARTIO_SEEK_SET );
+	}
+	if ( status == ARTIO_SUCCESS ) {
+		status = artio_file_fcopy( output_fh, input_fh, size );
+	}
 
-		/* set new allocation */
-		CHECK_STATUS( artio_parameter_set_long_array(output, "particle_file_sfc_index",
-					num_new_files+1, new_particle_file_sfc_index) );
+	artio_file_fclose( input_fh );
+	if ( status == ARTIO_SUCCESS ) {
+		status = artio_file_fclose( output_fh );
+	} else {
+		artio_file_fclose( output_fh );
+	}
+	return status;
+}
 
-		free( new_particle_file_sfc_index );
+int main( int argc, char *argv[] ) {
+	int num_new_files;
+	int num_threads;
+	int allocation_strategy;
+	int sfc_type;
+	int num_files;
+	int version;
+	int oct_counts;
+	int type, length;
+	char key[ARTIO_MAX_STRING_LENGTH];
+	int64_t num_root_cells;
+	int64_t *file_sfc_index;
+	int64_t *new_file_sfc_index;
+	double start;
 
-		/* load particle parameters */
-		CHECK_STATUS( artio_parameter_get_int(handle, "num_particle_species", &num_species) );
+	if ( argc < 4 || argc > 6 ) {
+		fprintf(stderr,"Usage: %s input_prefix output_prefix num_new_files [equal_sfc|equal_size] [num_threads]\n",argv[0]);
+		exit(1);
+	}
 
-		printf("num_particle_species = %d\n", num_species);
+	num_new_files = atoi(argv[3]);
+	if ( num_new_files < 1 ) {
+		fprintf(stderr,"num_new_files must be positive\n");
+		exit(1);
+	}
 
-		label = allocate(char *, num_species);
-		for ( i = 0; i < num_species; i++ ) {
-			label[i] = allocate(char, ARTIO_MAX_STRING_LENGTH);
+	allocation_strategy = ARTIO_ALLOC_EQUAL_SFC;
+	if ( argc > 4 ) {
+		if ( !strcmp( argv[4], "equal_size" ) ) {
+			allocation_strategy = ARTIO_ALLOC_EQUAL_SIZE;
+		} else if ( strcmp( argv[4], "equal_sfc" ) ) {
+			fprintf(stderr,"Unknown allocation strategy %s\n", argv[4] );
+			exit(1);
 		}
+	}
 
-		CHECK_STATUS( artio_parameter_get_string_array(handle, "particle_species_labels",
-				num_species, label) );
-
-		num_primary_variables = allocate(int, num_species);
-		num_secondary_variables = allocate(int, num_species);
-
-		CHECK_STATUS( artio_parameter_get_int_array(handle, "num_primary_variables",
-				num_species, num_primary_variables) );
-		CHECK_STATUS( artio_parameter_get_int_array(handle, "num_secondary_variables",
-				num_species, num_secondary_variables) );
-
-		primary_variable_labels_per_species = allocate(char **, num_species);
-		secondary_variable_labels_per_species = allocate(char **, num_species);
-
-		for(i=0;i<num_species;i++) {
-			printf("species %d: %s\n", i, label[i]);
-
-			primary_variable_labels_per_species[i] = allocate(char *, num_primary_variables[i]);
-			for (j = 0; j < num_primary_variables[i]; j++) {
-				primary_variable_labels_per_species[i][j] = allocate(char, ARTIO_MAX_STRING_LENGTH);
-			}
-
-			sprintf( species_label, "species_%02u_primary_variable_labels", i );
-			CHECK_STATUS( artio_parameter_get_string_array( handle, species_label,
-					num_primary_variables[i], primary_variable_labels_per_species[i] ) );
-
-			printf("primary variables:");
-			for ( j = 0; j < num_primary_variables[i]; j++ ) {
-				printf(" %s", primary_variable_labels_per_species[i][j]);
-			}
-			printf("\n");
-
-			if ( num_secondary_variables[i] > 0 ) {
-				secondary_variable_labels_per_species[i] = allocate(char *, num_secondary_variables[i]);
-				for (j = 0; j < num_secondary_variables[i]; j++) {
-					secondary_variable_labels_per_species[i][j] = allocate(char, ARTIO_MAX_STRING_LENGTH);
-				}
-
-				sprintf( species_label, "species_%02u_secondary_variable_labels", i );
-				CHECK_STATUS( artio_parameter_get_string_array( handle, species_label,
-						num_secondary_variables[i], secondary_variable_labels_per_species[i] ) );
-
-				printf("secondary variables:");
-				for ( j = 0; j < num_secondary_variables[i]; j++ ) {
-					printf(" %s", secondary_variable_labels_per_species[i][j]);
-				}
-				printf("\n");
-			}
-		}
+	num_threads = ( argc > 5 ) ? atoi(argv[5]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if ( num_threads < 1 ) num_threads = 1;
 
-		num_particles_per_species_per_root_tree = allocate(int, num_species*num_root_cells);
+	artio_fileset *handle = artio_fileset_open( argv[1], ARTIO_OPEN_HEADER, NULL );
+	if ( handle == NULL ) {
+		fprintf(stderr,"Unable to open fileset %s\n", argv[1] );
+		exit(1);
+	}
 
-		CHECK_STATUS( artio_particle_cache_sfc_range(handle, 0, num_root_cells-1) );
+	if ( handle->endian_swap ) {
+		/* records are copied verbatim, but the new header and offset
+		 * tables would be written in native byte order */
+		fprintf(stderr,"Unable to remap fileset %s with foreign byte order\n", argv[1] );
+		exit(1);
+	}
 
-		for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
-			CHECK_STATUS( artio_particle_read_root_cell_begin(handle, sfc,
-				&num_particles_per_species_per_root_tree[num_species*sfc]) );
-			CHECK_STATUS( artio_particle_read_root_cell_end(handle) );
-		}
+	CHECK_STATUS( artio_parameter_get_long(handle, "num_root_cells", &num_root_cells) );
+	if ( artio_parameter_get_int(handle, "sfc_type", &sfc_type) != ARTIO_SUCCESS ) {
+		sfc_type = ARTIO_SFC_HILBERT;
+	}
 
-		CHECK_STATUS( artio_fileset_add_particles(output,
-						num_new_files, ARTIO_ALLOC_MANUAL,
-						num_species, label,
-						num_primary_variables,
-						num_secondary_variables,
-						primary_variable_labels_per_species,
-						secondary_variable_labels_per_species,
-						num_particles_per_species_per_root_tree ) );
+	artio_fileset *output = artio_fileset_create( argv[2], sfc_type,
+		num_root_cells, num_root_cells, NULL );
+	if ( output == NULL ) {
+		fprintf(stderr, "Error creating artio fileset %s\n", argv[2]);
+		exit(1);
+	}
 
-		for ( i = 0; i < num_species; i++ ) {
-			free(label[i]);
+	new_file_sfc_index = allocate( int64_t, num_new_files+1 );
 
-			for ( j = 0; j < num_primary_variables[i]; j++ ) {
-				free(primary_variable_labels_per_species[i][j]);
-			}
-			free(primary_variable_labels_per_species[i]);
-			if ( num_secondary_variables[i] > 0 ) {
-				for ( j = 0; j < num_secondary_variables[i]; j++ ) {
-					free(secondary_variable_labels_per_species[i][j]);
-				}
-				free(secondary_variable_labels_per_species[i]);
-			}
-		}
-		free(primary_variable_labels_per_species);
-		free(secondary_variable_labels_per_species);
-		free(label);
+	if ( artio_fileset_has_grid(handle) ) {
+		start = wall_time();
+		CHECK_STATUS( artio_parameter_get_int(handle, "num_grid_files", &num_files) );
 
-#ifndef DEBUG
-		free(num_particles_per_species_per_root_tree);
-#endif
+		file_sfc_index = allocate( int64_t, num_files+1 );
+		CHECK_STATUS( artio_parameter_get_long_array(handle, "grid_file_sfc_index",
+				num_files+1, file_sfc_index) );
 
-		num_particles_per_species = allocate(int, num_species);
+		remap_component( argv[1], argv[2], 'g', num_files, file_sfc_index,
+				num_new_files, allocation_strategy, num_threads,
+				new_file_sfc_index );
 
-		num_vars = 1;
-		for ( i = 0; i < num_species; i++ ) {
-			if ( num_primary_variables[i] > num_vars ) {
-				num_vars = num_primary_variables[i];
-			}
-		}	
-		primary_variables = allocate(double, num_vars);
+		CHECK_STATUS( artio_parameter_set_int(output, "num_grid_files", num_new_files) );
+		CHECK_STATUS( artio_parameter_set_long_array(output, "grid_file_sfc_index",
+				num_new_files+1, new_file_sfc_index) );
 
-		num_vars = 1;
-		for ( i = 0; i < num_species; i++ ) {
-			if ( num_secondary_variables[i] > num_vars ) {
-				num_vars = num_secondary_variables[i];
-			}
+		if ( artio_parameter_get_int(handle, "grid_oct_counts",
+				&oct_counts) == ARTIO_SUCCESS && oct_counts ) {
+			CHECK_STATUS( copy_oct_counts( argv[1], argv[2] ) );
 		}
-		secondary_variables = allocate(float, num_vars);
-
-		for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
 
-			progress("remapping particles",num_root_cells,sfc);
+		free( file_sfc_index );
+		printf("remapped grid from %d to %d files in %.3f s\n",
+				num_files, num_new_files, wall_time() - start );
+	}
 
-			CHECK_STATUS( artio_particle_read_root_cell_begin(handle, sfc,
-						num_particles_per_species) );
+	if ( artio_fileset_has_particles(handle) ) {
+		start = wall_time();
+		CHECK_STATUS( artio_parameter_get_int(handle, "num_particle_files", &num_files) );
 
-#ifdef DEBUG
-			for ( i = 0; i < num_species; i++ ) {
-				if ( num_particles_per_species[i] != num_particles_per_species_per_root_tree[num_species*sfc+i] ) {
-					fprintf(stderr, "Error: number of particles for species %d does not match for sfc %ld, %d vs %d\n",
-						i, sfc, num_particles_per_species[i], num_particles_per_species_per_root_tree[num_species*sfc+i]);
-					exit(1);
-				}
-			}
-#endif
+		file_sfc_index = allocate( int64_t, num_files+1 );
+		CHECK_STATUS( artio_parameter_get_long_array(handle, "particle_file_sfc_index",
+				num_files+1, file_sfc_index) );
 
-			CHECK_STATUS( artio_particle_write_root_cell_begin(output, sfc,
-				num_particles_per_species) );
+		remap_component( argv[1], argv[2], 'p', num_files, file_sfc_index,
+				num_new_files, allocation_strategy, num_threads,
+				new_file_sfc_index );
 
-			for ( i = 0; i < num_species; i++ ) {
-				CHECK_STATUS( artio_particle_read_species_begin(handle, i) );
-				CHECK_STATUS( artio_particle_write_species_begin(output, i) );
+		CHECK_STATUS( artio_parameter_set_int(output, "num_particle_files", num_new_files) );
+		CHECK_STATUS( artio_parameter_set_long_array(output, "particle_file_sfc_index",
+				num_new_files+1, new_file_sfc_index) );
 
-				for ( j = 0; j < num_particles_per_species[i]; j++ ) {
-					CHECK_STATUS( artio_particle_read_particle(handle, &pid, &subspecies,
-							primary_variables, secondary_variables) );
-					CHECK_STATUS( artio_particle_write_particle(output, pid, subspecies,
-							primary_variables, secondary_variables) );
-				}
+		free( file_sfc_index );
+		printf("remapped particles from %d to %d files in %.3f s\n",
+				num_files, num_new_files, wall_time() - start );
+	}
 
-				CHECK_STATUS( artio_particle_read_species_end(handle) );
-				CHECK_STATUS( artio_particle_write_species_end(output) );
-			}
+	free( new_file_sfc_index );
 
-			CHECK_STATUS( artio_particle_read_root_cell_end(handle) );
-			CHECK_STATUS( artio_particle_write_root_cell_end(output) );
+	/* records are copied verbatim, so keep the version they were written
+	 * with (compressed grids require a newer reader) */
+	if ( artio_parameter_get_int(handle, "ARTIO_MAJOR_VERSION", &version) == ARTIO_SUCCESS ) {
+		artio_parameter_list_replace(output->parameters, "ARTIO_MAJOR_VERSION",
+				1, &version, ARTIO_TYPE_INT);
+		if ( artio_parameter_get_int(handle, "ARTIO_MINOR_VERSION", &version) == ARTIO_SUCCESS ) {
+			artio_parameter_list_replace(output->parameters, "ARTIO_MINOR_VERSION",
+					1, &version, ARTIO_TYPE_INT);
 		}
-
-		free(num_primary_variables);
-		free(num_secondary_variables);
-		free(primary_variables);
-		free(secondary_variables);
-		free(num_particles_per_species);
-
-#ifdef DEBUG
-		free(num_particles_per_species_per_root_tree);
-#endif
-
-		CHECK_STATUS( artio_fileset_close_particles(handle) );
-		CHECK_STATUS( artio_fileset_close_particles(output) );
-
-		printf("\ndone writing particle data\n");
 	}
 
 	/* copy any parameters in handle that are not in output */
@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "artio.h"
+
+#define NUM_GRID	512
+
+int compare_sfc( const void *a, const void *b ) {
+	int64_t sa = *(const int64_t *)a;
+	int64_t sb = *(const int64_t *)b;
+	return ( sa > sb ) - ( sa < sb );
+}
+
+double elapsed( clock_t start ) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main( int argc, char *argv[] ) {
+	int i;
+	int64_t n, num_cells;
+	int coords[3];
+	int64_t *sfc_list;
+	char filename[256];
+	artio_fileset *handle;
+	artio_selection *selection;
+	clock_t start;
+
+	if ( argc < 2 || argc > 3 ) {
+		fprintf(stderr,"Usage: %s scratch_prefix [num_cells]\n",argv[0]);
+		exit(1);
+	}
+
+	num_cells = ( argc == 3 ) ? atol(argv[2]) : 10000000;
+
+	/* a header-only fileset is enough to describe the root grid */
+	handle = artio_fileset_create( argv[1], ARTIO_SFC_HILBERT,
+			(int64_t)NUM_GRID*NUM_GRID*NUM_GRID,
+			(int64_t)NUM_GRID*NUM_GRID*NUM_GRID, NULL );
+	if ( handle == NULL ) {
+		fprintf(stderr,"Unable to create fileset %s\n", argv[1] );
+		exit(1);
+	}
+
+	sfc_list = (int64_t *)malloc( num_cells*sizeof(int64_t) );
+	if ( sfc_list == NULL ) {
+		fprintf(stderr,"Unable to allocate %ld root cells\n", num_cells );
+		exit(1);
+	}
+
+	/* random single root cells */
+	srand(1);
+	selection = artio_selection_allocate( handle );
+	start = clock();
+	for ( n = 0; n < num_cells; n++ ) {
+		for ( i = 0; i < 3; i++ ) {
+			coords[i] = rand() % NUM_GRID;
+		}
+		if ( artio_selection_add_root_cell( selection, coords ) != ARTIO_SUCCESS ) {
+			fprintf(stderr,"Error adding root cell\n");
+			exit(1);
+		}
+	}
+	printf("random add_root_cell:  %ld cells, %ld selected, %.3f s\n",
+			num_cells, artio_selection_size( selection ), elapsed(start) );
+	artio_selection_destroy( selection );
+
+	/* the same cells as a sorted sfc list */
+	srand(1);
+	for ( n = 0; n < num_cells; n++ ) {
+		sfc_list[n] = 0;
+		for ( i = 0; i < 3; i++ ) {
+			sfc_list[n] = sfc_list[n]*NUM_GRID + rand() % NUM_GRID;
+		}
+	}
+	qsort( sfc_list, num_cells, sizeof(int64_t), compare_sfc );
+
+	selection = artio_selection_allocate( handle );
+	start = clock();
+	if ( artio_selection_add_sfc_list( selection, sfc_list, num_cells ) != ARTIO_SUCCESS ) {
+		fprintf(stderr,"Error adding sfc list\n");
+		exit(1);
+	}
+	printf("sorted add_sfc_list:   %ld cells, %ld selected, %.3f s\n",
+			num_cells, artio_selection_size( selection ), elapsed(start) );
+	artio_selection_destroy( selection );
+
+	/* the same cells one at a time in sfc order */
+	selection = artio_selection_allocate( handle );
+	start = clock();
+	for ( n = 0; n < num_cells; n++ ) {
+		if ( artio_selection_add_range( selection, sfc_list[n], sfc_list[n] ) != ARTIO_SUCCESS ) {
+			fprintf(stderr,"Error adding range\n");
+			exit(1);
+		}
+	}
+	printf("monotone add_range:    %ld cells, %ld selected, %.3f s\n",
+			num_cells, artio_selection_size( selection ), elapsed(start) );
+	artio_selection_destroy( selection );
+
+	free( sfc_list );
+	artio_fileset_close( handle );
+
+	snprintf( filename, 256, "%s.art", argv[1] );
+	remove( filename );
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#include "artio.h"
+
+#define NUM_VARIABLES	8
+#define NUM_LEVELS		3
+#define MAX_WRITERS		256
+
+double wall_time() {
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+/* stand-in for the simulation advancing between root cells */
+void compute( double seconds ) {
+	double end = wall_time() + seconds;
+	while ( wall_time() < end );
+}
+
+typedef struct {
+	artio_fileset *handle;
+	double work;
+} writer_args;
+
+void write_root_cells( artio_fileset *handle, double work ) {
+	int i, level, oct;
+	int64_t sfc, sfc_begin, sfc_end;
+	int num_octs_per_level[NUM_LEVELS];
+	int refined[8];
+	float variables[8*NUM_VARIABLES];
+
+	for ( i = 0; i < 8*NUM_VARIABLES; i++ ) {
+		variables[i] = (float)i;
+	}
+	for ( level = 0; level < NUM_LEVELS; level++ ) {
+		num_octs_per_level[level] = 1<<level;
+	}
+
+	artio_fileset_get_sfc_range( handle, &sfc_begin, &sfc_end );
+
+	for ( sfc = sfc_begin; sfc <= sfc_end; sfc++ ) {
+		compute( work );
+
+		artio_grid_write_root_cell_begin( handle, sfc, variables,
+				NUM_LEVELS, num_octs_per_level );
+		for ( level = 1; level <= NUM_LEVELS; level++ ) {
+			artio_grid_write_level_begin( handle, level );
+			for ( oct = 0; oct < num_octs_per_level[level-1]; oct++ ) {
+				for ( i = 0; i < 8; i++ ) {
+					refined[i] = ( level < NUM_LEVELS && i < 2 );
+				}
+				artio_grid_write_oct( handle, variables, refined );
+			}
+			artio_grid_write_level_end( handle );
+		}
+		artio_grid_write_root_cell_end( handle );
+	}
+}
+
+void *writer_thread( void *args ) {
+	writer_args *wargs = (writer_args *)args;
+	write_root_cells( wargs->handle, wargs->work );
+	return NULL;
+}
+
+double write_checkpoint( char *prefix, int num_grid, int num_files,
+		int num_writers, double work ) {
+	int i;
+	int64_t sfc, num_root_cells;
+	char *labels[NUM_VARIABLES] = { "V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7" };
+	artio_fileset *handle;
+	artio_fileset *writers[MAX_WRITERS];
+	writer_args args[MAX_WRITERS];
+	pthread_t threads[MAX_WRITERS];
+	double start;
+
+	start = wall_time();
+
+	num_root_cells = (int64_t)num_grid*num_grid*num_grid;
+	handle = artio_fileset_create( prefix, ARTIO_SFC_HILBERT,
+			num_root_cells, num_root_cells, NULL );
+	if ( handle == NULL ) {
+		fprintf(stderr,"Unable to create fileset %s\n", prefix );
+		exit(1);
+	}
+
+	if ( artio_fileset_add_grid( handle, num_files, ARTIO_ALLOC_EQUAL_SFC,
+			NUM_VARIABLES, labels ) != ARTIO_SUCCESS ) {
+		fprintf(stderr,"Unable to add grid\n");
+		exit(1);
+	}
+
+	for ( sfc = 0; sfc < num_root_cells; sfc++ ) {
+		artio_fileset_add_grid_sfc( handle, sfc, NUM_LEVELS, (1<<NUM_LEVELS)-1 );
+	}
+
+	if ( artio_fileset_commit_grid( handle ) != ARTIO_SUCCESS ) {
+		fprintf(stderr,"Unable to commit grid\n");
+		exit(1);
+	}
+
+	if ( num_writers > 1 ) {
+		if ( artio_grid_fork_writers( handle, num_writers, writers ) != ARTIO_SUCCESS ) {
+			fprintf(stderr,"Unable to fork %d writers\n", num_writers );
+			exit(1);
+		}
+		for ( i = 0; i < num_writers; i++ ) {
+			args[i].handle = writers[i];
+			args[i].work = work;
+			pthread_create( &threads[i], NULL, writer_thread, &args[i] );
+		}
+		for ( i = 0; i < num_writers; i++ ) {
+			pthread_join( threads[i], NULL );
+		}
+		if ( artio_grid_join_writers( handle, num_writers, writers ) != ARTIO_SUCCESS ) {
+			fprintf(stderr,"Parallel write failed\n");
+			exit(1);
+		}
+	} else {
+		write_root_cells( handle, work );
+	}
+
+	artio_fileset_close( handle );
+
+	return wall_time() - start;
+}
+
+int main( int argc, char *argv[] ) {
+	int num_grid, num_files, num_buffers, num_writers;
+	double work, sync_time, async_time, parallel_time;
+
+	if ( argc < 2 || argc > 7 ) {
+		fprintf(stderr,"Usage: %s output_prefix [num_grid] [work_us_per_root_cell] [num_buffers] [num_writers] [num_files]\n",argv[0]);
+		exit(1);
+	}
+
+	num_grid = ( argc > 2 ) ? atoi(argv[2]) : 64;
+	work = ( argc > 3 ) ? 1e-6*atof(argv[3]) : 1e-6;
+	num_buffers = ( argc > 4 ) ? atoi(argv[4]) : 3;
+	num_writers = ( argc > 5 ) ? atoi(argv[5]) : 4;
+	num_files = ( argc > 6 ) ? atoi(argv[6]) : 4;
+
+	if ( num_writers < 1 || num_writers > MAX_WRITERS ) {
+		fprintf(stderr,"num_writers must be between 1 and %d\n", MAX_WRITERS );
+		exit(1);
+	}
+
+	artio_fileset_set_async_buffers( 0 );
+	sync_time = write_checkpoint( argv[1], num_grid, num_files, 1, work );
+	printf("synchronous writes:          %.3f s\n", sync_time );
+
+	artio_fileset_set_async_buffers( num_buffers );
+	async_time = write_checkpoint( argv[1], num_grid, num_files, 1, work );
+	printf("asynchronous writes (%d buf): %.3f s\n", num_buffers, async_time );
+
+	artio_fileset_set_async_buffers( 0 );
+	parallel_time = write_checkpoint( argv[1], num_grid, num_files, num_writers, work );
+	printf("parallel writers (%d):        %.3f s\n", num_writers, parallel_time );
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+package main
+
+import (
+	"fmt"
+	"log"
+	"os"
+	"strconv"
+	"time"
+
+	artio "github.com/phil-mansfield/go-artio"
+)
+
+// lookup reads the value of key from the fileset through the per-key cgo
+// getters.
+func lookup(h artio.Fileset, key artio.Key) {
+	switch key.Type {
+	case artio.String: h.GetString(key)
+	case artio.Float:  h.GetFloat(key)
+	case artio.Double: h.GetDouble(key)
+	case artio.Int:    h.GetInt(key)
+	case artio.Long:   h.GetLong(key)
+	}
+}
+
+// lookupHeader reads the value of key from a header snapshot.
+func lookupHeader(hd *artio.Header, key artio.Key) {
+	switch key.Type {
+	case artio.String: hd.GetString(key.Name)
+	case artio.Float:  hd.GetFloat(key.Name)
+	case artio.Double: hd.GetDouble(key.Name)
+	case artio.Int:    hd.GetInt(key.Name)
+	case artio.Long:   hd.GetLong(key.Name)
+	}
+}
+
+func report(name string, n int, t0 time.Time) {
+	dt := time.Since(t0)
+	fmt.Printf("%28s | %10.1f ns/op\n", name, float64(dt.Nanoseconds())/float64(n))
+}
+
+func BenchHeader(prefix string, reps int) error {
+	h, err := artio.FilesetOpen(prefix, 0, artio.NullContext)
+	if err != nil { return err }
+	defer h.Close()
+
+	keys, err := h.Keys()
+	if err != nil { return err }
+	if len(keys) == 0 { return fmt.Errorf("Fileset has no parameters.") }
+	lookups := reps*len(keys)
+
+	t0 := time.Now()
+	for i := 0; i < reps; i++ {
+		for _, iter := h.Iterate(); iter; _, iter = h.Iterate() { }
+	}
+	report("Iterate (per key)", lookups, t0)
+
+	t0 = time.Now()
+	for i := 0; i < reps; i++ {
+		if _, err := h.Keys(); err != nil { return err }
+	}
+	report("Keys (per key)", lookups, t0)
+
+	t0 = time.Now()
+	for i := 0; i < reps; i++ {
+		for _, key := range keys { lookup(h, h.Key(key.Name)) }
+	}
+	report("Key + Get", lookups, t0)
+
+	t0 = time.Now()
+	for i := 0; i < reps; i++ {
+		for _, key := range keys {
+			key, err := h.FindKey(key.Name)
+			if err != nil { return err }
+			lookup(h, key)
+		}
+	}
+	report("FindKey + Get", lookups, t0)
+
+	t0 = time.Now()
+	for i := 0; i < reps; i++ {
+		if _, err := h.Header(); err != nil { return err }
+	}
+	report("Header (snapshot)", reps, t0)
+
+	hd, err := h.Header()
+	if err != nil { return err }
+	t0 = time.Now()
+	for i := 0; i < reps; i++ {
+		for _, key := range keys { lookupHeader(hd, key) }
+	}
+	report("Header.Get", lookups, t0)
+
+	return nil
+}
+
+func main() {
+	if len(os.Args) < 2 || len(os.Args) > 3 {
+		log.Fatalf("Usage: ./bench_header fileset_prefix [repetitions]")
+	}
+	reps := 10000
+	if len(os.Args) == 3 {
+		var err error
+		reps, err = strconv.Atoi(os.Args[2])
+		if err != nil { log.Fatal(err.Error()) }
+	}
+	if err := BenchHeader(os.Args[1], reps); err != nil {
+		log.Fatal(err.Error())
+	}
+}
@@ -0,0 +1,119 @@
+package main
+
+import (
+	"fmt"
+	"log"
+	"os"
+	"testing"
+
+	artio "github.com/phil-mansfield/go-artio"
+)
+
+// The benchmarks are run with testing.Benchmark, so they report the same
+// ns/op and allocation figures as go test -bench, over a fileset given on
+// the command line, such as one written by
+// cart_utilities/artio_utilities/artio_generate. The same benchmarks run
+// under go test -bench from artio_bench_test.go.
+
+func benchOpen(prefix string, flag artio.OpenType) func(b *testing.B) {
+	return func(b *testing.B) {
+		for i := 0; i < b.N; i++ {
+			h, err := artio.FilesetOpen(prefix, flag, artio.NullContext)
+			if err != nil { b.Fatal(err) }
+			h.Close()
+		}
+	}
+}
+
+func benchHeader(h artio.Fileset) func(b *testing.B) {
+	return func(b *testing.B) {
+		for i := 0; i < b.N; i++ {
+			if _, err := h.Header(); err != nil { b.Fatal(err) }
+		}
+	}
+}
+
+func benchCount(h artio.Fileset, roots int64) func(b *testing.B) {
+	return func(b *testing.B) {
+		for i := 0; i < b.N; i++ {
+			if _, err := h.CountInRange(0, roots - 1); err != nil { b.Fatal(err) }
+		}
+	}
+}
+
+func benchPositions(
+	h artio.Fileset, roots int64, species int, counts []int64,
+) func(b *testing.B) {
+	return func(b *testing.B) {
+		buf := make([][3]float32, counts[species])
+		b.SetBytes(int64(len(buf)) * 12)
+		b.ResetTimer()
+		for i := 0; i < b.N; i++ {
+			err := h.GetPositionsAt(species, 0, roots - 1, buf)
+			if err != nil { b.Fatal(err) }
+		}
+	}
+}
+
+func benchCells(h artio.Fileset, roots int64, maxLevel int) func(b *testing.B) {
+	return func(b *testing.B) {
+		for i := 0; i < b.N; i++ {
+			_, err := h.ReadCells(0, roots - 1, 0, maxLevel, artio.ReadLeafs)
+			if err != nil { b.Fatal(err) }
+		}
+	}
+}
+
+func BenchRead(prefix string) error {
+	h, err := artio.FilesetOpen(prefix, 0, artio.NullContext)
+	if err != nil { return err }
+	defer h.Close()
+
+	hd, err := h.Header()
+	if err != nil { return err }
+	rootsBuf, err := hd.GetLong("num_root_cells")
+	if err != nil { return err }
+	roots := rootsBuf[0]
+
+	run := func(name string, fn func(b *testing.B)) {
+		res := testing.Benchmark(fn)
+		fmt.Printf("%-24s %s %s\n", name, res.String(), res.MemString())
+	}
+
+	// open only the components the fileset has
+	flag := artio.OpenType(0)
+	if hd.HasKey("num_particle_species") { flag |= artio.OpenParticles }
+	if hd.HasKey("num_grid_variables") { flag |= artio.OpenGrid }
+
+	run("Open", benchOpen(prefix, flag))
+	run("Header", benchHeader(h))
+
+	if hd.HasKey("num_particle_species") {
+		if err := h.OpenParticles(); err != nil { return err }
+		defer h.CloseParticles()
+
+		counts, err := h.CountInRange(0, roots - 1)
+		if err != nil { return err }
+		run("CountInRange", benchCount(h, roots))
+		for species := range counts {
+			run(fmt.Sprintf("GetPositions/%d", species),
+				benchPositions(h, roots, species, counts))
+		}
+	}
+
+	if hd.HasKey("num_grid_variables") {
+		maxLevel, err := hd.GetInt("grid_max_level")
+		if err != nil { return err }
+		if err := h.OpenGrid(); err != nil { return err }
+		defer h.CloseGrid()
+
+		run("ReadCells", benchCells(h, roots, int(maxLevel[0])))
+	}
+
+	return nil
+}
+
+func main() {
+	if len(os.Args) != 2 { log.Fatalf("Usage: ./bench_read fileset_prefix") }
+	if err := BenchRead(os.Args[1]); err != nil { log.Fatal(err.Error()) }
+}
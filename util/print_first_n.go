@@ -9,32 +9,24 @@ import (
 	artio "github.com/phil-mansfield/go-artio"
 )
 
-// TODO: Move this into artio.go
-func getIntOrLong(h artio.Fileset, key artio.Key) []int64 {
-	if key.Type == artio.Int {
-		out32 := h.GetInt(key)
-		out := make([]int64, len(out32))
-		for i := range out { out[i] = int64(out32[i]) }
-		return out
-	} else {
-		return h.GetLong(key)
-	}
-}
-
 func PrintFirstN(prefix string, n int) error {
 	h, err := artio.FilesetOpen(prefix, 0, artio.NullContext)
 	if err != nil { return err }
 	defer h.Close()
 
-	var speciesNumKey artio.Key
-	if h.HasKey("particle_species_num") {
-		speciesNumKey = h.Key("particle_species_num")
-	} else {
-		speciesNumKey = h.Key("num_particles_per_species")
+	hd, err := h.Header()
+	if err != nil { return err }
+
+	speciesNumName := "num_particles_per_species"
+	if hd.HasKey("particle_species_num") {
+		speciesNumName = "particle_species_num"
 	}
-	counts := getIntOrLong(h, speciesNumKey)
-	fileIndices := getIntOrLong(h, h.Key("particle_file_sfc_index"))
-	masses := h.GetFloat(h.Key("particle_species_mass"))
+	counts, err := hd.GetIntOrLong(speciesNumName)
+	if err != nil { return err }
+	fileIndices, err := hd.GetIntOrLong("particle_file_sfc_index")
+	if err != nil { return err }
+	masses, err := hd.GetFloat("particle_species_mass")
+	if err != nil { return err }
 
 	err = h.OpenParticles()
 	if err != nil { return err }
@@ -44,12 +36,16 @@ func PrintFirstN(prefix string, n int) error {
 	if err != nil { return err }
 	defer h.ParticleClearSfcCache()
 
-	roots := h.GetLong(h.Key("num_root_cells"))[0]
+	rootsBuf, err := hd.GetLong("num_root_cells")
+	if err != nil { return err }
+	roots := rootsBuf[0]
 	numSpeciesBuf := make([]int32, len(counts))
 	numParticlesRead := 0
 
-	primarySizes := h.GetInt(h.Key("num_primary_variables"))
-	secondarySizes := h.GetInt(h.Key("num_secondary_variables"))
+	primarySizes, err := hd.GetInt("num_primary_variables")
+	if err != nil { return err }
+	secondarySizes, err := hd.GetInt("num_secondary_variables")
+	if err != nil { return err }
 	primaryBufs := make([][]float64, len(primarySizes))
 	for i := range primaryBufs {
 		primaryBufs[i] = make([]float64, primarySizes[i])
@@ -12,15 +12,30 @@ func PrintHeader(prefix string) error {
 	h, err := artio.FilesetOpen(prefix, 0, artio.NullContext)
 	if err != nil { return err }
 
-	for key, iter := h.Iterate(); iter; key, iter = h.Iterate() {
+	defer h.Close()
+
+	hd, err := h.Header()
+	if err != nil { return err }
+
+	for _, key := range hd.Keys() {
 		ff := "%36s | %6s | %.5g\n"
 		f := "%36s | %6s | %v\n"
 		switch key.Type {
-		case artio.String: fmt.Printf(f,  key.Name, "String", h.GetString(key))
-		case artio.Float:  fmt.Printf(ff, key.Name, "Float",  h.GetFloat(key))
-		case artio.Double: fmt.Printf(ff, key.Name, "Double", h.GetDouble(key))
-		case artio.Int:    fmt.Printf(f,  key.Name, "Int",    h.GetInt(key))
-		case artio.Long:   fmt.Printf(f,  key.Name, "Long",   h.GetLong(key))
+		case artio.String:
+			v, _ := hd.GetString(key.Name)
+			fmt.Printf(f, key.Name, "String", v)
+		case artio.Float:
+			v, _ := hd.GetFloat(key.Name)
+			fmt.Printf(ff, key.Name, "Float", v)
+		case artio.Double:
+			v, _ := hd.GetDouble(key.Name)
+			fmt.Printf(ff, key.Name, "Double", v)
+		case artio.Int:
+			v, _ := hd.GetInt(key.Name)
+			fmt.Printf(f, key.Name, "Int", v)
+		case artio.Long:
+			v, _ := hd.GetLong(key.Name)
+			fmt.Printf(f, key.Name, "Long", v)
 		default: return fmt.Errorf("Unrecognized ARTIO type.")
 		}
 	}